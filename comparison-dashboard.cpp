@@ -0,0 +1,225 @@
+#include "comparison-dashboard.h"
+#include "terminal-events.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+
+const char* const RESET = "\033[0m";
+const char* const TITLE = "\033[1m\033[34m";
+const char* const LABEL = "\033[1m\033[36m";
+const char* const VALUE = "\033[37m";
+
+constexpr int HEADER_ROWS = 3;   // banner, rule, column titles
+constexpr double FRAME_TIME = 1.0 / 60.0;
+
+struct Row {
+    const char* label;
+    // Text of the cell for one engine
+    std::string (*format)(const TelemetryFrame& frame, double fuel_used);
+};
+
+std::string fixed(double value, int decimals, const char* unit) {
+    char text[48];
+    std::snprintf(text, sizeof(text), "%.*f %s", decimals, value, unit);
+    return text;
+}
+
+const Row ROWS[] = {
+    { "RPM", [](const TelemetryFrame& f, double) { return fixed(f.rpm, 0, ""); } },
+    { "Gear", [](const TelemetryFrame& f, double) { return std::to_string(f.gear) + (f.manual_transmission ? " (M)" : " (A)"); } },
+    { "Vehicle Speed", [](const TelemetryFrame& f, double) { return fixed(f.vehicle_speed * 3.6, 0, "km/h"); } },
+    { "Power Output", [](const TelemetryFrame& f, double) { return fixed(f.power_output, 1, "kW"); } },
+    { "Torque", [](const TelemetryFrame& f, double) { return fixed(f.torque, 0, "Nm"); } },
+    { "Thermal Efficiency", [](const TelemetryFrame& f, double) { return fixed(f.thermal_efficiency * 100, 1, "%"); } },
+    { "Fuel Consumption", [](const TelemetryFrame& f, double) { return fixed(f.fuel_consumption, 2, "kg/h"); } },
+    { "BSFC", [](const TelemetryFrame& f, double) { return fixed(f.brake_specific_fuel_consumption, 0, "g/kWh"); } },
+    { "NOx Emissions", [](const TelemetryFrame& f, double) { return fixed(f.nox_emissions, 3, "g/kWh"); } },
+    { "Engine Temperature", [](const TelemetryFrame& f, double) { return fixed(f.engine_temperature, 1, "C"); } },
+    { "Water Injection", [](const TelemetryFrame& f, double) { return std::string(f.water_injection_active ? "On" : "Off"); } },
+    { "Fuel Used", [](const TelemetryFrame&, double fuel) { return fixed(fuel * 1000, 1, "g"); } },
+};
+constexpr int ROW_COUNT = sizeof(ROWS) / sizeof(ROWS[0]);
+
+std::string package_title(const std::vector<std::string>& package) {
+    if (package.empty()) {
+        return "stock";
+    }
+    std::string title;
+    for (const std::string& upgrade : package) {
+        title += (title.empty() ? "" : "+") + upgrade;
+    }
+    return title;
+}
+
+// Pads or cuts `text` to exactly `width` characters
+std::string fit(const std::string& text, int width, bool right) {
+    if (static_cast<int>(text.size()) >= width) {
+        return text.substr(0, width);
+    }
+    std::string pad(width - text.size(), ' ');
+    return right ? pad + text : text + pad;
+}
+
+void move_to(std::string& out, int row, int column) {
+    out += "\033[" + std::to_string(row) + ";" + std::to_string(column) + "H";
+}
+
+} // namespace
+
+ComparisonDashboard::ComparisonDashboard(const EngineSpec& spec) :
+    spec(spec),
+    acceleration(0),
+    label_width(20),
+    column_width(16),
+    full_repaint(true)
+{
+}
+
+bool ComparisonDashboard::add_package(const std::vector<std::string>& package, std::string& error) {
+    Column column{ package_title(package), std::make_unique<SixStrokeEngine>(spec), 0.0, std::string(), RunSummary() };
+    column.engine->set_random_disturbances(false);
+    for (const std::string& upgrade : package) {
+        if (!column.engine->apply_upgrade(upgrade)) {
+            error = "unknown upgrade " + upgrade;
+            return false;
+        }
+    }
+    // The upgrade announcements are not news on the dashboard
+    EngineEvent applied[16];
+    while (column.engine->drain_events(applied, 16) > 0) {
+    }
+    columns.push_back(std::move(column));
+    return true;
+}
+
+void ComparisonDashboard::layout(int terminal_columns) {
+    int count = std::max<int>(1, static_cast<int>(columns.size()));
+    column_width = std::max(10, std::min(24, (terminal_columns - label_width - 2) / count));
+    cells.assign(static_cast<std::size_t>(ROW_COUNT + 2) * columns.size(), std::string());
+    full_repaint = true;
+}
+
+void ComparisonDashboard::render(std::string& out) {
+    out.clear();
+    if (full_repaint) {
+        out += "\033[2J\033[H";
+        out += TITLE;
+        out += "Six-Stroke Engine Comparison";
+        out += RESET;
+        out += "   a/d: acceleration | e/q: shift | m: transmission mode | Ctrl+C: quit";
+        move_to(out, 2, 1);
+        out += std::string(label_width + column_width * columns.size(), '=');
+        for (int row = 0; row < ROW_COUNT; ++row) {
+            move_to(out, HEADER_ROWS + 2 + row, 1);
+            out += LABEL;
+            out += fit(ROWS[row].label, label_width, false);
+            out += RESET;
+        }
+        move_to(out, HEADER_ROWS + 2 + ROW_COUNT, 1);
+        out += LABEL;
+        out += fit("Last Event", label_width, false);
+        out += RESET;
+    }
+
+    // Row 0 of the grid holds the titles, then one row per metric and the
+    // column's latest engine event
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+        Column& column = columns[c];
+        const TelemetryFrame frame = column.engine->sample_telemetry(column.engine->get_simulation_time());
+        for (int row = 0; row <= ROW_COUNT + 1; ++row) {
+            std::string text = row == 0 ? fit(column.title, column_width - 1, true)
+                : row > ROW_COUNT ? fit(column.last_event, column_width - 1, true)
+                : fit(ROWS[row - 1].format(frame, column.fuel_used), column_width - 1, true);
+            std::string& cell = cells[row * columns.size() + c];
+            if (full_repaint || cell != text) {
+                move_to(out, row == 0 ? HEADER_ROWS : HEADER_ROWS + 1 + row, label_width + 1 + static_cast<int>(c) * column_width);
+                out += row == 0 ? TITLE : VALUE;
+                out += text;
+                out += RESET;
+                cell.swap(text);
+            }
+        }
+    }
+    full_repaint = false;
+}
+
+void ComparisonDashboard::handle_key(char key) {
+    switch (key) {
+    case 'a':
+    case 'd':
+        acceleration = std::max(-50.0, std::min(50.0, acceleration + (key == 'a' ? 10.0 : -10.0)));
+        for (Column& column : columns) {
+            column.engine->set_acceleration(acceleration);
+        }
+        break;
+    case 'e':
+        for (Column& column : columns) column.engine->manual_upshift();
+        break;
+    case 'q':
+        for (Column& column : columns) column.engine->manual_downshift();
+        break;
+    case 'm':
+        for (Column& column : columns) column.engine->toggle_transmission_mode();
+        break;
+    }
+}
+
+void ComparisonDashboard::run() {
+    TerminalEvents events;
+    std::string error;
+    if (!events.open(error)) {
+        std::cout << "Cannot start the event loop: " << error << std::endl;
+        return;
+    }
+    events.set_frame_interval(1.0 / 60.0);
+    layout(TerminalEvents::columns());
+
+    std::string keys;
+    std::string frame_text;
+    auto last_frame = std::chrono::steady_clock::now();
+    while (true) {
+        unsigned ready = events.wait(keys);
+        if (ready & TerminalEvents::QUIT) {
+            break;
+        }
+        if (ready & TerminalEvents::RESIZE) {
+            layout(TerminalEvents::columns());
+        }
+        for (char key : keys) {
+            handle_key(key);
+        }
+
+        auto frame_start = std::chrono::steady_clock::now();
+        // Clamped as in run_simulation, and stepped at the frame rate
+        double dt = std::min(SixStrokeEngine::MAX_FRAME_TIME, std::chrono::duration<double>(frame_start - last_frame).count());
+        last_frame = frame_start;
+        EngineEvent pending[16];
+        for (Column& column : columns) {
+            column.engine->advance(dt, FRAME_TIME);
+            for (std::size_t n = column.engine->drain_events(pending, 16); n > 0; n = column.engine->drain_events(pending, 16)) {
+                column.last_event = describe_engine_event(pending[n - 1]);
+            }
+        }
+
+        render(frame_text);
+        std::cout << frame_text << std::flush;
+
+        double frame_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - frame_start).count();
+        for (Column& column : columns) {
+            TelemetryFrame frame = column.engine->sample_telemetry(column.engine->get_simulation_time());
+            column.fuel_used += frame.fuel_consumption * dt / 3600.0;
+            column.summary.add_frame(frame_seconds, dt, frame);
+        }
+    }
+
+    events.close();
+    move_to(frame_text = RESET, HEADER_ROWS + ROW_COUNT + 4, 1);
+    std::cout << frame_text << "\n";
+    for (const Column& column : columns) {
+        std::cout << column.title << ":\n";
+        column.summary.print(std::cout);
+    }
+}
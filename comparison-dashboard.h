@@ -0,0 +1,48 @@
+#ifndef COMPARISON_DASHBOARD_H
+#define COMPARISON_DASHBOARD_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "six-stroke-engine.h"
+#include "run-summary.h"
+
+// Several engines built from one spec with different upgrade packages,
+// driven by the same key presses and shown side by side. Random
+// disturbances are off so the packages are the only difference. All engines
+// are stepped together each frame. The dashboard is laid out as a grid of
+// text cells sized to the terminal; each frame rewrites only the cells whose
+// text changed, in a single write.
+class ComparisonDashboard {
+public:
+    explicit ComparisonDashboard(const EngineSpec& spec);
+
+    // Adds a column for the spec with `package` applied; false if an upgrade is unknown
+    bool add_package(const std::vector<std::string>& package, std::string& error);
+    void run();
+
+private:
+    struct Column {
+        std::string title;
+        std::unique_ptr<SixStrokeEngine> engine;
+        double fuel_used;   // kg
+        std::string last_event;
+        RunSummary summary;
+    };
+
+    void layout(int terminal_columns);
+    void render(std::string& out);
+    void handle_key(char key);
+
+    EngineSpec spec;
+    std::vector<Column> columns;
+    double acceleration;
+
+    int label_width;
+    int column_width;
+    std::vector<std::string> cells;      // [row * columns + column] as last drawn
+    bool full_repaint;
+};
+
+#endif // COMPARISON_DASHBOARD_H
@@ -0,0 +1,166 @@
+#include "config-watcher.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+#ifdef __linux__
+#include <csignal>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Editors write in several steps; wait this long for the file to settle
+constexpr auto SETTLE_TIME = std::chrono::milliseconds(50);
+constexpr auto POLL_INTERVAL = std::chrono::milliseconds(250);
+
+} // namespace
+
+ConfigWatcher::ConfigWatcher(const std::string& path, const std::string& variant) :
+    path(path),
+    variant(variant),
+    running(false),
+    notify_fd(-1),
+    spec_ready(false),
+    error_ready(false)
+{
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    stop();
+}
+
+bool ConfigWatcher::start(std::string& error) {
+    if (running) {
+        return true;
+    }
+#ifdef __linux__
+    // Watch the directory rather than the file, since editors often save by
+    // writing a new file and renaming it over the old one
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    if (directory.empty()) {
+        directory = ".";
+    }
+    notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notify_fd < 0 || inotify_add_watch(notify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        if (notify_fd >= 0) {
+            close(notify_fd);
+            notify_fd = -1;
+        }
+        error = "cannot watch " + directory.string();
+        return false;
+    }
+#endif
+    running = true;
+    worker = std::thread(&ConfigWatcher::watch, this);
+    return true;
+}
+
+void ConfigWatcher::stop() {
+    running = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+#ifdef __linux__
+    if (notify_fd >= 0) {
+        close(notify_fd);
+        notify_fd = -1;
+    }
+#endif
+}
+
+bool ConfigWatcher::take(EngineSpec& spec) {
+    if (!spec_ready.load(std::memory_order_acquire)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    spec = std::move(pending_spec);
+    spec_ready.store(false, std::memory_order_relaxed);
+    return true;
+}
+
+bool ConfigWatcher::take_error(std::string& error) {
+    if (!error_ready.load(std::memory_order_acquire)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    error = std::move(pending_error);
+    error_ready.store(false, std::memory_order_relaxed);
+    return true;
+}
+
+void ConfigWatcher::reload() {
+    std::vector<EngineSpec> specs;
+    std::string error;
+    auto chosen = specs.end();
+    if (load_engine_specs(path, specs, error)) {
+        chosen = variant.empty() ? specs.begin()
+            : std::find_if(specs.begin(), specs.end(), [&](const EngineSpec& s) { return s.name == variant; });
+        if (chosen == specs.end()) {
+            error = "no variant " + variant + " in " + path;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (chosen != specs.end()) {
+        pending_spec = std::move(*chosen);
+        spec_ready.store(true, std::memory_order_release);
+    }
+    else {
+        pending_error = error;
+        error_ready.store(true, std::memory_order_release);
+    }
+}
+
+#ifdef __linux__
+void ConfigWatcher::watch() {
+    // Leave signals to the main thread, which may be waiting on a signalfd
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, nullptr);
+
+    const std::string name = std::filesystem::path(path).filename().string();
+    alignas(inotify_event) char buffer[4096];
+    pollfd fd = { notify_fd, POLLIN, 0 };
+
+    while (running) {
+        if (poll(&fd, 1, static_cast<int>(POLL_INTERVAL.count())) <= 0) {
+            continue;
+        }
+        bool changed = false;
+        // Drain until the directory has been quiet for SETTLE_TIME
+        do {
+            ssize_t length;
+            while ((length = read(notify_fd, buffer, sizeof(buffer))) > 0) {
+                for (char* p = buffer; p < buffer + length;) {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                    changed |= event->len > 0 && name == event->name;
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+        } while (running && poll(&fd, 1, static_cast<int>(SETTLE_TIME.count())) > 0);
+
+        if (changed && running) {
+            reload();
+        }
+    }
+}
+#else
+void ConfigWatcher::watch() {
+    std::error_code ec;
+    auto last_write = std::filesystem::last_write_time(path, ec);
+
+    while (running) {
+        std::this_thread::sleep_for(POLL_INTERVAL);
+        auto write_time = std::filesystem::last_write_time(path, ec);
+        if (!ec && write_time != last_write) {
+            last_write = write_time;
+            std::this_thread::sleep_for(SETTLE_TIME);
+            reload();
+        }
+    }
+}
+#endif
@@ -0,0 +1,48 @@
+#ifndef CONFIG_WATCHER_H
+#define CONFIG_WATCHER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "engine-spec.h"
+
+// Watches an engine spec file and re-parses it on a background thread each
+// time it is saved (inotify on Linux, modification-time polling elsewhere).
+// The frame loop picks up results with take(), which never waits on file
+// I/O or parsing, so applying a new spec fits between two frames.
+class ConfigWatcher {
+public:
+    // `variant` names the section to use; empty takes the first
+    ConfigWatcher(const std::string& path, const std::string& variant);
+    ~ConfigWatcher();
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    bool start(std::string& error);
+    void stop();
+
+    // Newest spec parsed since the last call, if any
+    bool take(EngineSpec& spec);
+    // Error of the newest failed parse since the last call, if any
+    bool take_error(std::string& error);
+
+private:
+    void watch();
+    void reload();
+
+    std::string path;
+    std::string variant;
+    std::thread worker;
+    std::atomic<bool> running;
+    int notify_fd;
+
+    std::mutex mutex;
+    std::atomic<bool> spec_ready;
+    std::atomic<bool> error_ready;
+    EngineSpec pending_spec;
+    std::string pending_error;
+};
+
+#endif // CONFIG_WATCHER_H
@@ -0,0 +1,54 @@
+#include "cosim-slave.h"
+#include <algorithm>
+#include <cmath>
+
+CoSimSlave::CoSimSlave(SixStrokeEngine& engine, double max_internal_step)
+    : engine(engine), max_internal_step(max_internal_step > 0 ? max_internal_step : 0.001),
+      before_step(), can_roll_back(false), step_count(0), rollback_count(0) {
+}
+
+bool CoSimSlave::do_step(double current_time, double step_size) {
+    const double now = engine.get_simulation_time();
+    if (!(step_size > 0) || std::abs(current_time - now) > 1e-9 * std::max(1.0, std::abs(now))) {
+        return false;
+    }
+
+    before_step = engine.snapshot();
+    can_roll_back = true;
+
+    engine.advance(step_size, max_internal_step);
+    // Land exactly on the communication point instead of the summed substeps
+    engine.set_simulation_time(current_time + step_size);
+    ++step_count;
+    return true;
+}
+
+bool CoSimSlave::rollback() {
+    if (!can_roll_back || !engine.restore(before_step)) {
+        return false;
+    }
+    can_roll_back = false;
+    ++rollback_count;
+    return true;
+}
+
+void CoSimSlave::get_state(EngineSnapshot& state) const {
+    state = engine.snapshot();
+}
+
+bool CoSimSlave::set_state(const EngineSnapshot& state) {
+    can_roll_back = false;
+    return engine.restore(state);
+}
+
+double CoSimSlave::time() const {
+    return engine.get_simulation_time();
+}
+
+std::uint64_t CoSimSlave::steps() const {
+    return step_count;
+}
+
+std::uint64_t CoSimSlave::rollbacks() const {
+    return rollback_count;
+}
@@ -0,0 +1,40 @@
+#ifndef COSIM_SLAVE_H
+#define COSIM_SLAVE_H
+
+#include <cstdint>
+
+#include "six-stroke-engine.h"
+#include "engine-state.h"
+
+// FMI-style co-simulation wrapper around a SixStrokeEngine. The master calls
+// do_step() with any communication step size; it is split into internal steps
+// no longer than max_internal_step. The state before each step is kept in a
+// fixed snapshot so the master can roll back and retry with a smaller step.
+// Saving and restoring state never touches the heap.
+class CoSimSlave {
+public:
+    explicit CoSimSlave(SixStrokeEngine& engine, double max_internal_step = 0.001);
+
+    // Advances from current_time to current_time + step_size. Fails without
+    // stepping if current_time is not the slave's time or step_size <= 0.
+    bool do_step(double current_time, double step_size);
+    // Returns to the state before the last successful do_step()
+    bool rollback();
+
+    void get_state(EngineSnapshot& state) const;
+    bool set_state(const EngineSnapshot& state);
+
+    double time() const;
+    std::uint64_t steps() const;
+    std::uint64_t rollbacks() const;
+
+private:
+    SixStrokeEngine& engine;
+    double max_internal_step;
+    EngineSnapshot before_step;
+    bool can_roll_back;
+    std::uint64_t step_count;
+    std::uint64_t rollback_count;
+};
+
+#endif // COSIM_SLAVE_H
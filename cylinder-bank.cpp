@@ -0,0 +1,206 @@
+#include "cylinder-bank.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "fast-math.h"
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double AMBIENT_PRESSURE = 101325.0;
+constexpr double AMBIENT_TEMPERATURE = 300.0;
+// Steam expansion pressure relative to the combustion peak
+constexpr double STEAM_FRACTION = 0.25;
+
+// Reference gas temperatures of the strokes that do not follow from compression
+constexpr double COMBUSTION_TEMPERATURE = 2200.0;
+constexpr double STEAM_TEMPERATURE = 700.0;
+
+// 1 when the whole-number stroke equals `target`, else 0. Computed as
+// max(1 - |d|, 0) through abs() because GCC turns comparisons into branches.
+inline double is_stroke(double stroke, double target) {
+    double x = 1.0 - std::abs(stroke - target);
+    return 0.5 * (x + std::abs(x));
+}
+
+}
+
+CylinderBank::CylinderBank(const EngineParameters<double>& params, const std::vector<int>& firing_order)
+    : piston_area(PI / 4.0 * params.bore * params.bore),
+      crank_radius(params.stroke / 2.0),
+      rod_length(params.rod_length),
+      cycle_work_base(0),
+      cycle_work_per_peak(0) {
+    const double swept_volume = piston_area * params.stroke;
+    clearance_volume = swept_volume / (params.compression_ratio - 1.0);
+    bottom_volume = clearance_volume + swept_volume;
+
+    const std::size_t n = static_cast<std::size_t>(std::max(params.num_cylinders, 1));
+    phases.assign(n, 0.0);
+    pressures.assign(n, AMBIENT_PRESSURE);
+    temperatures.assign(n, AMBIENT_TEMPERATURE);
+    torques.assign(n, 0.0);
+    active_flags.assign(n, 1);
+    if (!set_firing_order(firing_order)) {
+        std::vector<int> sequential(n);
+        std::iota(sequential.begin(), sequential.end(), 0);
+        set_firing_order(sequential);
+    }
+
+    // Integrate one cycle of cylinder 0 alone at peak pressures 0 and 1; the
+    // cycle work is linear in the peak, so that fixes it for any target torque
+    const std::vector<std::uint8_t> flags = active_flags;
+    std::fill(active_flags.begin(), active_flags.end(), 0);
+    active_flags[0] = 1;
+    const int samples = 2160;
+    const double step = CYCLE_DEGREES / samples * PI / 180.0;
+    double work_at_zero = 0, work_at_one = 0;
+    for (int i = 0; i < samples; ++i) {
+        double angle = (i + 0.5) * CYCLE_DEGREES / samples + phase_offset[0];
+        evaluate(std::fmod(angle, CYCLE_DEGREES), 0.0);
+        work_at_zero += torques[0] * step;
+        evaluate(std::fmod(angle, CYCLE_DEGREES), 1.0);
+        work_at_one += torques[0] * step;
+    }
+    cycle_work_base = work_at_zero;
+    cycle_work_per_peak = work_at_one - work_at_zero;
+    active_flags = flags;
+}
+
+bool CylinderBank::set_firing_order(const std::vector<int>& firing_order) {
+    const std::size_t n = phases.size();
+    std::vector<int> sorted = firing_order;
+    std::sort(sorted.begin(), sorted.end());
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        if (sorted[i] != static_cast<int>(i)) {
+            return false;
+        }
+    }
+    if (sorted.size() != n) {
+        return false;
+    }
+
+    order = firing_order;
+    phase_offset.assign(n, 0.0);
+    offset_sin.assign(n, 0.0);
+    offset_cos.assign(n, 1.0);
+    for (std::size_t position = 0; position < n; ++position) {
+        const int cylinder = order[position];
+        phase_offset[cylinder] = position * CYCLE_DEGREES / n;
+        offset_sin[cylinder] = std::sin(phase_offset[cylinder] * PI / 180.0);
+        offset_cos[cylinder] = std::cos(phase_offset[cylinder] * PI / 180.0);
+    }
+    return true;
+}
+
+const std::vector<int>& CylinderBank::firing_order() const {
+    return order;
+}
+
+void CylinderBank::set_deactivated_count(int count) {
+    std::fill(active_flags.begin(), active_flags.end(), 1);
+    const int n = static_cast<int>(order.size());
+    for (int position = 1; position < n && count > 0; position += 2, --count) {
+        active_flags[order[position]] = 0;
+    }
+}
+
+int CylinderBank::active_count() const {
+    return static_cast<int>(std::count(active_flags.begin(), active_flags.end(), 1));
+}
+
+std::size_t CylinderBank::size() const {
+    return phases.size();
+}
+
+double CylinderBank::update(double crank_angle, double mean_torque) {
+    // Each active cylinder delivers its share of one cycle's work (three revolutions)
+    const int active = active_count();
+    double peak_pressure = 0;
+    if (active > 0) {
+        const double cycle_work = mean_torque * CYCLE_DEGREES * PI / 180.0 / active;
+        peak_pressure = std::max(0.0, (cycle_work - cycle_work_base) / cycle_work_per_peak);
+    }
+    evaluate(crank_angle, peak_pressure);
+    return std::accumulate(torques.begin(), torques.end(), 0.0);
+}
+
+void CylinderBank::evaluate(double crank_angle, double peak_pressure) {
+    const double angle = crank_angle * PI / 180.0;
+    const double crank_sin = std::sin(angle);
+    const double crank_cos = std::cos(angle);
+    const double r = crank_radius;
+    const double l = rod_length;
+    const std::size_t n = phases.size();
+
+    const double area = piston_area;
+    const double clearance = clearance_volume;
+    const double swept_volume = bottom_volume - clearance_volume;
+    const double* offset = phase_offset.data();
+    const double* rotate_sin = offset_sin.data();
+    const double* rotate_cos = offset_cos.data();
+    const std::uint8_t* firing = active_flags.data();
+    double* phase_out = phases.data();
+    double* pressure_out = pressures.data();
+    double* temperature_out = temperatures.data();
+    double* torque_out = torques.data();
+
+    // The arrays never overlap, which spares the vectorizer its runtime alias checks
+#if defined(__GNUC__)
+#pragma GCC ivdep
+#endif
+    for (std::size_t i = 0; i < n; ++i) {
+        // Both values are positive, so truncating through int is floor()
+        double phase = crank_angle - offset[i] + CYCLE_DEGREES;
+        phase -= CYCLE_DEGREES * static_cast<int>(phase * (1.0 / CYCLE_DEGREES));
+        phase_out[i] = phase;
+        const double stroke = static_cast<int>(phase * (1.0 / 180.0));
+
+        // Stroke selection as 0/1 weights rather than branches or table
+        // lookups, so the loop vectorizes across cylinders. Open valves hold
+        // ambient pressure; a deactivated cylinder keeps them shut and traps
+        // ambient charge at bottom dead centre for the whole cycle.
+        const double on = firing[i];
+        const double power = on * is_stroke(stroke, 2.0);
+        const double steam = on * is_stroke(stroke, 4.0);
+        const double open = on - power - steam - on * is_stroke(stroke, 1.0);
+        const double compression = 1.0 - power - steam - open;
+
+        // Angle of this cylinder's crank throw by rotating the shared crank angle
+        const double s = crank_sin * rotate_cos[i] - crank_cos * rotate_sin[i];
+        const double c = crank_cos * rotate_cos[i] + crank_sin * rotate_sin[i];
+        const double root = std::sqrt(l * l - r * r * s * s);
+        const double volume = clearance + area * (r + l - r * c - root);
+        const double lever = r * s * (1.0 + r * c / root);
+
+        const double ratio = (clearance + (compression + open) * swept_volume) / volume;
+        const double exponent = 1.35 * compression + 1.3 * power + 1.1 * steam;
+        const double pressure = (AMBIENT_PRESSURE + (power + STEAM_FRACTION * steam) * peak_pressure) * fast_pow(ratio, exponent);
+        const double reference_temperature = AMBIENT_TEMPERATURE * (compression + open) +
+            COMBUSTION_TEMPERATURE * power + STEAM_TEMPERATURE * steam;
+        pressure_out[i] = pressure;
+        temperature_out[i] = reference_temperature * fast_pow(ratio, exponent - (1.0 - open));
+        torque_out[i] = (pressure - AMBIENT_PRESSURE) * area * lever;
+    }
+}
+
+const std::vector<double>& CylinderBank::phase() const {
+    return phases;
+}
+
+const std::vector<double>& CylinderBank::pressure() const {
+    return pressures;
+}
+
+const std::vector<double>& CylinderBank::temperature() const {
+    return temperatures;
+}
+
+const std::vector<double>& CylinderBank::torque() const {
+    return torques;
+}
+
+const std::vector<std::uint8_t>& CylinderBank::active() const {
+    return active_flags;
+}
@@ -0,0 +1,69 @@
+#ifndef CYLINDER_BANK_H
+#define CYLINDER_BANK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "engine-model.h"
+
+// Per-cylinder state of the six-stroke cycle, stored as parallel arrays so
+// the update loop runs branch-free across cylinders. The 1080 degree cycle is
+// intake, compression, combustion, exhaust, steam expansion and exhaust, each
+// 180 degrees. Cylinders are phased evenly in firing order. Cycle pressures
+// are scaled so that the mean crankshaft torque over a cycle matches the
+// mean-value torque of the engine model, which leaves the ripple on top.
+class CylinderBank {
+public:
+    static constexpr double CYCLE_DEGREES = 1080.0;
+
+    CylinderBank(const EngineParameters<double>& params, const std::vector<int>& firing_order);
+
+    // Cylinder indices in firing order; must be a permutation of 0..N-1
+    bool set_firing_order(const std::vector<int>& order);
+    const std::vector<int>& firing_order() const;
+
+    // Deactivates every other cylinder in firing order, up to `count`. A
+    // deactivated cylinder keeps its valves shut and unfuelled, acting as a
+    // gas spring with no net work; the active ones carry the whole load. The
+    // engine sets the count from its cylinder-deactivation state on every
+    // performance update.
+    void set_deactivated_count(int count);
+    int active_count() const;
+    std::size_t size() const;
+
+    // Evaluates all cylinders at `crank_angle` degrees into the cycle and
+    // returns the instantaneous crankshaft torque in Nm
+    double update(double crank_angle, double mean_torque);
+
+    const std::vector<double>& phase() const;        // degrees into each cylinder's cycle
+    const std::vector<double>& pressure() const;     // Pa
+    const std::vector<double>& temperature() const;  // gas temperature, K
+    const std::vector<double>& torque() const;       // Nm contributed by each cylinder
+    const std::vector<std::uint8_t>& active() const;
+
+private:
+    void evaluate(double crank_angle, double peak_pressure);
+
+    double piston_area;
+    double crank_radius;
+    double rod_length;
+    double clearance_volume;
+    double bottom_volume;
+
+    // Cycle work of one active cylinder is base + peak_pressure * per_peak
+    double cycle_work_base;
+    double cycle_work_per_peak;
+
+    std::vector<int> order;
+    std::vector<double> phase_offset;
+    std::vector<double> offset_sin;
+    std::vector<double> offset_cos;
+    std::vector<double> phases;
+    std::vector<double> pressures;
+    std::vector<double> temperatures;
+    std::vector<double> torques;
+    std::vector<std::uint8_t> active_flags;
+};
+
+#endif // CYLINDER_BANK_H
@@ -0,0 +1,119 @@
+#ifndef DUAL_NUMBER_H
+#define DUAL_NUMBER_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+// Forward-mode dual number carrying N partial derivatives alongside its value.
+// Instantiating EngineModel with Dual<double, N> yields the value and N
+// directional derivatives of every metric in a single evaluation.
+template <typename T, std::size_t N = 1>
+struct Dual {
+    T value{};
+    std::array<T, N> grad{};
+
+    constexpr Dual() = default;
+    constexpr Dual(T v) : value(v) {}
+
+    // Independent variable seeded along derivative direction `index`
+    static constexpr Dual variable(T v, std::size_t index) {
+        Dual d(v);
+        d.grad[index] = T(1);
+        return d;
+    }
+
+    Dual& operator+=(const Dual& o) {
+        value += o.value;
+        for (std::size_t i = 0; i < N; ++i) grad[i] += o.grad[i];
+        return *this;
+    }
+
+    Dual& operator-=(const Dual& o) {
+        value -= o.value;
+        for (std::size_t i = 0; i < N; ++i) grad[i] -= o.grad[i];
+        return *this;
+    }
+
+    Dual& operator*=(const Dual& o) {
+        for (std::size_t i = 0; i < N; ++i) grad[i] = grad[i] * o.value + value * o.grad[i];
+        value *= o.value;
+        return *this;
+    }
+
+    Dual& operator/=(const Dual& o) {
+        T inv = T(1) / o.value;
+        for (std::size_t i = 0; i < N; ++i) grad[i] = (grad[i] - value * inv * o.grad[i]) * inv;
+        value *= inv;
+        return *this;
+    }
+};
+
+template <typename T, std::size_t N>
+Dual<T, N> operator-(Dual<T, N> a) {
+    a.value = -a.value;
+    for (auto& g : a.grad) g = -g;
+    return a;
+}
+
+template <typename T, std::size_t N>
+Dual<T, N> operator+(Dual<T, N> a, const Dual<T, N>& b) { return a += b; }
+template <typename T, std::size_t N>
+Dual<T, N> operator-(Dual<T, N> a, const Dual<T, N>& b) { return a -= b; }
+template <typename T, std::size_t N>
+Dual<T, N> operator*(Dual<T, N> a, const Dual<T, N>& b) { return a *= b; }
+template <typename T, std::size_t N>
+Dual<T, N> operator/(Dual<T, N> a, const Dual<T, N>& b) { return a /= b; }
+
+template <typename T, std::size_t N>
+bool operator<(const Dual<T, N>& a, const Dual<T, N>& b) { return a.value < b.value; }
+template <typename T, std::size_t N>
+bool operator>(const Dual<T, N>& a, const Dual<T, N>& b) { return a.value > b.value; }
+template <typename T, std::size_t N>
+bool operator<=(const Dual<T, N>& a, const Dual<T, N>& b) { return a.value <= b.value; }
+template <typename T, std::size_t N>
+bool operator>=(const Dual<T, N>& a, const Dual<T, N>& b) { return a.value >= b.value; }
+
+template <typename T, std::size_t N>
+Dual<T, N> abs(const Dual<T, N>& a) { return a.value < T(0) ? -a : a; }
+
+template <typename T, std::size_t N>
+Dual<T, N> sqrt(const Dual<T, N>& a) {
+    Dual<T, N> r(std::sqrt(a.value));
+    T scale = T(0.5) / r.value;
+    for (std::size_t i = 0; i < N; ++i) r.grad[i] = a.grad[i] * scale;
+    return r;
+}
+
+template <typename T, std::size_t N>
+Dual<T, N> exp(const Dual<T, N>& a) {
+    Dual<T, N> r(std::exp(a.value));
+    for (std::size_t i = 0; i < N; ++i) r.grad[i] = a.grad[i] * r.value;
+    return r;
+}
+
+template <typename T, std::size_t N>
+Dual<T, N> log(const Dual<T, N>& a) {
+    Dual<T, N> r(std::log(a.value));
+    for (std::size_t i = 0; i < N; ++i) r.grad[i] = a.grad[i] / a.value;
+    return r;
+}
+
+// d(a^b) = b a^(b-1) da + a^b ln(a) db
+template <typename T, std::size_t N>
+Dual<T, N> pow(const Dual<T, N>& a, const Dual<T, N>& b) {
+    Dual<T, N> r(std::pow(a.value, b.value));
+    T da = b.value * std::pow(a.value, b.value - T(1));
+    T db = a.value > T(0) ? r.value * std::log(a.value) : T(0);
+    for (std::size_t i = 0; i < N; ++i) r.grad[i] = da * a.grad[i] + db * b.grad[i];
+    return r;
+}
+
+// Plain value of a scalar, so generic code can branch or print regardless of type
+template <typename T>
+T value_of(T x) { return x; }
+
+template <typename T, std::size_t N>
+T value_of(const Dual<T, N>& x) { return x.value; }
+
+#endif // DUAL_NUMBER_H
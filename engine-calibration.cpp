@@ -0,0 +1,354 @@
+#include "engine-calibration.h"
+#include "six-stroke-engine.h"
+#include "dual-number.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <thread>
+
+namespace {
+
+using CalibrationScalar = Dual<double, CalibrationFitter::ParameterCount>;
+
+bool parse_row(const std::string& line, double (&fields)[4]) {
+    const char* p = line.c_str();
+    for (int i = 0; i < 4; ++i) {
+        char* end = nullptr;
+        fields[i] = std::strtod(p, &end);
+        if (end == p) {
+            return false;
+        }
+        p = end;
+        while (*p == ' ' || *p == '\t') ++p;
+        if (i < 3) {
+            if (*p != ',') {
+                return false;
+            }
+            ++p;
+        }
+    }
+    return true;
+}
+
+// Solves a x = b in place by Gaussian elimination with partial pivoting
+template <std::size_t N>
+bool solve(std::array<std::array<double, N>, N> a, std::array<double, N> b, std::array<double, N>& x) {
+    for (std::size_t col = 0; col < N; ++col) {
+        std::size_t pivot = col;
+        for (std::size_t row = col + 1; row < N; ++row) {
+            if (std::abs(a[row][col]) > std::abs(a[pivot][col])) pivot = row;
+        }
+        if (a[pivot][col] == 0.0) {
+            return false;
+        }
+        std::swap(a[col], a[pivot]);
+        std::swap(b[col], b[pivot]);
+        for (std::size_t row = col + 1; row < N; ++row) {
+            double f = a[row][col] / a[col][col];
+            for (std::size_t k = col; k < N; ++k) a[row][k] -= f * a[col][k];
+            b[row] -= f * b[col];
+        }
+    }
+    for (std::size_t i = N; i-- > 0;) {
+        double sum = b[i];
+        for (std::size_t k = i + 1; k < N; ++k) sum -= a[i][k] * x[k];
+        x[i] = sum / a[i][i];
+    }
+    return true;
+}
+
+} // namespace
+
+bool load_dyno_csv(const std::string& path, std::vector<DynoSample>& samples, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+        ++line_number;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        double fields[4];
+        if (!parse_row(line, fields)) {
+            if (line_number == 1) {
+                continue; // header
+            }
+            error = path + ":" + std::to_string(line_number) + ": expected rpm,torque,power,fuel";
+            return false;
+        }
+        if (fields[0] <= 0) {
+            error = path + ":" + std::to_string(line_number) + ": rpm must be positive";
+            return false;
+        }
+        samples.push_back({ fields[0], fields[1], fields[2], fields[3] });
+    }
+    return true;
+}
+
+CalibrationFitter::CalibrationFitter(const SixStrokeEngine& engine, std::vector<DynoSample> samples) :
+    parameters(engine.model_parameters()),
+    upgrades(engine.upgrade_effect()),
+    base_trim(engine.calibration()),
+    point(engine.operating_point()),
+    samples(std::move(samples)),
+    free{ true, true, false, true },
+    thread_count(std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+void CalibrationFitter::set_free(Parameter parameter, bool is_free) {
+    free[parameter] = is_free;
+}
+
+void CalibrationFitter::set_thread_count(unsigned threads) {
+    thread_count = std::max(1u, threads);
+}
+
+void CalibrationFitter::accumulate(const Vector& scale, std::size_t begin, std::size_t end, NormalEquations& out) const {
+    using S = CalibrationScalar;
+
+    // Parameters are fitted as multipliers of their starting values so every
+    // unknown is O(1) regardless of its physical unit.
+    EngineParameters<S> params{
+        S(parameters.bore), S(parameters.stroke), S(parameters.compression_ratio), S(parameters.rod_length),
+        S(parameters.mean_effective_pressure), S(parameters.optimal_temperature), parameters.num_cylinders
+    };
+    UpgradeEffect<S> effect;
+    effect.volumetric = S(upgrades.volumetric);
+    effect.nox = S(upgrades.nox);
+    effect.temperature_offset = S(upgrades.temperature_offset);
+
+    S x[ParameterCount];
+    for (int i = 0; i < ParameterCount; ++i) {
+        x[i] = free[i] ? S::variable(scale[i], i) : S(scale[i]);
+    }
+    params.mean_effective_pressure = S(parameters.mean_effective_pressure) * x[MeanEffectivePressure];
+    effect.power = S(upgrades.power) * x[PowerTrim];
+    effect.thermal = S(upgrades.thermal) * x[ThermalTrim];
+    effect.fuel = S(upgrades.fuel) * x[FuelTrim];
+
+    for (std::size_t k = begin; k < end; ++k) {
+        const DynoSample& sample = samples[k];
+        PerformanceMetrics<S> m = EngineModel<S>::update_performance(
+            params, effect, { S(sample.rpm), S(point.engine_temperature), S(point.volumetric_efficiency), point.water_injection_active });
+
+        const S* predicted[3] = { &m.torque, &m.power_output, &m.fuel_consumption };
+        const double measured[3] = { sample.torque, sample.power, sample.fuel };
+        for (int j = 0; j < 3; ++j) {
+            double weight = 1.0 / std::max(std::abs(measured[j]), 1e-6);
+            double r = (predicted[j]->value - measured[j]) * weight;
+            out.cost += 0.5 * r * r;
+            for (int a = 0; a < ParameterCount; ++a) {
+                double ja = predicted[j]->grad[a] * weight;
+                out.jtr[a] += ja * r;
+                for (int b = 0; b < ParameterCount; ++b) {
+                    out.jtj[a][b] += ja * predicted[j]->grad[b] * weight;
+                }
+            }
+        }
+    }
+}
+
+CalibrationFitter::NormalEquations CalibrationFitter::evaluate(const Vector& scale) const {
+    std::size_t threads = std::min<std::size_t>(thread_count, std::max<std::size_t>(1, samples.size() / 256));
+    std::vector<NormalEquations> partial(threads);
+    std::vector<std::thread> workers;
+    std::size_t chunk = (samples.size() + threads - 1) / threads;
+
+    for (std::size_t t = 1; t < threads; ++t) {
+        std::size_t begin = std::min(samples.size(), t * chunk);
+        std::size_t end = std::min(samples.size(), begin + chunk);
+        workers.emplace_back([this, &scale, begin, end, &partial, t]() {
+            accumulate(scale, begin, end, partial[t]);
+        });
+    }
+    accumulate(scale, 0, std::min(samples.size(), chunk), partial[0]);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    NormalEquations total = partial[0];
+    for (std::size_t t = 1; t < threads; ++t) {
+        total.cost += partial[t].cost;
+        for (int a = 0; a < ParameterCount; ++a) {
+            total.jtr[a] += partial[t].jtr[a];
+            for (int b = 0; b < ParameterCount; ++b) total.jtj[a][b] += partial[t].jtj[a][b];
+        }
+    }
+    return total;
+}
+
+CalibrationResult CalibrationFitter::make_result(const Vector& scale) const {
+    CalibrationResult result{};
+    result.mean_effective_pressure = parameters.mean_effective_pressure * scale[MeanEffectivePressure];
+    result.trim = base_trim;
+    result.trim.power *= scale[PowerTrim];
+    result.trim.thermal *= scale[ThermalTrim];
+    result.trim.fuel *= scale[FuelTrim];
+    return result;
+}
+
+CalibrationResult CalibrationFitter::fit(int max_iterations) {
+    Vector scale;
+    scale.fill(1.0);
+    if (samples.empty()) {
+        return make_result(scale);
+    }
+
+    NormalEquations current = evaluate(scale);
+    const double initial_cost = current.cost;
+    double lambda = 1e-3;
+    bool converged = false;
+    int iteration = 0;
+
+    for (; iteration < max_iterations && !converged; ++iteration) {
+        Matrix a = current.jtj;
+        Vector g;
+        for (int i = 0; i < ParameterCount; ++i) {
+            g[i] = -current.jtr[i];
+            if (a[i][i] == 0.0) {
+                // Fixed (or unobservable) parameter: pin its step to zero
+                a[i].fill(0.0);
+                a[i][i] = 1.0;
+                g[i] = 0.0;
+            }
+            else {
+                a[i][i] *= 1.0 + lambda;
+            }
+        }
+
+        Vector step{};
+        bool accepted = false;
+        if (solve(a, g, step)) {
+            Vector trial;
+            bool positive = true;
+            for (int i = 0; i < ParameterCount; ++i) {
+                trial[i] = scale[i] + step[i];
+                positive = positive && trial[i] > 0;
+            }
+            if (positive) {
+                NormalEquations next = evaluate(trial);
+                if (next.cost < current.cost) {
+                    double improvement = (current.cost - next.cost) / std::max(current.cost, 1e-300);
+                    double step_norm = 0;
+                    for (double s : step) step_norm = std::max(step_norm, std::abs(s));
+                    scale = trial;
+                    current = next;
+                    lambda = std::max(lambda / 10, 1e-12);
+                    accepted = true;
+                    converged = improvement < 1e-12 || step_norm < 1e-10;
+                }
+            }
+        }
+        if (!accepted) {
+            lambda *= 10;
+            converged = lambda > 1e12;
+        }
+    }
+
+    CalibrationResult result = make_result(scale);
+    result.initial_cost = initial_cost;
+    result.final_cost = current.cost;
+    result.iterations = iteration;
+    result.converged = converged;
+    return result;
+}
+
+namespace {
+
+struct CalibrationKey {
+    const char* name;
+    double CalibrationResult::* field;
+    double UpgradeEffect<double>::* trim;
+};
+
+const CalibrationKey CALIBRATION_KEYS[] = {
+    { "mean_effective_pressure", &CalibrationResult::mean_effective_pressure, nullptr },
+    { "power_trim", nullptr, &UpgradeEffect<double>::power },
+    { "thermal_trim", nullptr, &UpgradeEffect<double>::thermal },
+    { "volumetric_trim", nullptr, &UpgradeEffect<double>::volumetric },
+    { "fuel_trim", nullptr, &UpgradeEffect<double>::fuel },
+    { "nox_trim", nullptr, &UpgradeEffect<double>::nox },
+    { "temperature_offset", nullptr, &UpgradeEffect<double>::temperature_offset },
+};
+
+double& calibration_value(CalibrationResult& result, const CalibrationKey& key) {
+    return key.field ? result.*key.field : result.trim.*key.trim;
+}
+
+} // namespace
+
+bool save_calibration(const std::string& path, const CalibrationResult& result, std::string& error) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    out << "# Six-stroke engine calibration\n" << std::setprecision(std::numeric_limits<double>::max_digits10);
+    CalibrationResult copy = result;
+    for (const CalibrationKey& key : CALIBRATION_KEYS) {
+        out << key.name << " = " << calibration_value(copy, key) << "\n";
+    }
+    out.flush();
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool load_calibration(const std::string& path, CalibrationResult& result, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    CalibrationResult loaded{};
+    loaded.trim = UpgradeEffect<double>();
+    bool seen[std::size(CALIBRATION_KEYS)] = {};
+    std::string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+        ++line_number;
+        std::size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        std::size_t equals = line.find('=');
+        std::string name = line.substr(first, equals == std::string::npos ? std::string::npos : equals - first);
+        name.erase(name.find_last_not_of(" \t") + 1);
+        auto key = std::find_if(std::begin(CALIBRATION_KEYS), std::end(CALIBRATION_KEYS),
+                                [&](const CalibrationKey& k) { return name == k.name; });
+        char* end = nullptr;
+        const char* text = equals == std::string::npos ? "" : line.c_str() + equals + 1;
+        double value = std::strtod(text, &end);
+        // Only blanks or a comment may follow the number
+        const char* rest = end + std::strspn(end, " \t\r");
+        if (key == std::end(CALIBRATION_KEYS) || end == text || !std::isfinite(value) || (*rest && *rest != '#')) {
+            error = path + ":" + std::to_string(line_number) + ": expected <key> = <number>";
+            return false;
+        }
+        calibration_value(loaded, *key) = value;
+        seen[key - std::begin(CALIBRATION_KEYS)] = true;
+    }
+    if (!seen[0] || loaded.mean_effective_pressure <= 0) {
+        error = path + ": missing or non-positive mean_effective_pressure";
+        return false;
+    }
+    result = loaded;
+    return true;
+}
+
+void CalibrationFitter::apply(SixStrokeEngine& engine, const CalibrationResult& result) {
+    engine.set_calibration(result.mean_effective_pressure, result.trim);
+}
@@ -0,0 +1,85 @@
+#ifndef ENGINE_CALIBRATION_H
+#define ENGINE_CALIBRATION_H
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "engine-model.h"
+
+class SixStrokeEngine;
+
+// One bench measurement: torque in Nm, power in kW, fuel flow in kg/h
+struct DynoSample {
+    double rpm;
+    double torque;
+    double power;
+    double fuel;
+};
+
+// Reads "rpm,torque,power,fuel" rows; a non-numeric first line is treated as a header.
+bool load_dyno_csv(const std::string& path, std::vector<DynoSample>& samples, std::string& error);
+
+struct CalibrationResult {
+    double mean_effective_pressure;
+    UpgradeEffect<double> trim;
+    double initial_cost;
+    double final_cost;
+    int iterations;
+    bool converged;
+};
+
+// A fitted calibration as "key = value" lines (mean_effective_pressure and
+// the six trims), so it can be fitted once and applied to later runs with
+// CalibrationFitter::apply. Loading fills only those fields.
+bool save_calibration(const std::string& path, const CalibrationResult& result, std::string& error);
+bool load_calibration(const std::string& path, CalibrationResult& result, std::string& error);
+
+// Levenberg-Marquardt fit of the engine's MEP and calibration trims to dyno
+// data. Residuals are relative errors of torque, power and fuel; their
+// Jacobian comes from dual numbers and the normal equations are accumulated
+// in parallel over chunks of samples.
+class CalibrationFitter {
+public:
+    enum Parameter {
+        MeanEffectivePressure,
+        PowerTrim,
+        ThermalTrim,
+        FuelTrim,
+        ParameterCount
+    };
+
+    CalibrationFitter(const SixStrokeEngine& engine, std::vector<DynoSample> samples);
+
+    // Thermal and fuel trims only appear as a ratio in the fuel flow, so the
+    // thermal trim is held fixed unless explicitly freed.
+    void set_free(Parameter parameter, bool free);
+    void set_thread_count(unsigned threads);
+    CalibrationResult fit(int max_iterations = 100);
+
+    static void apply(SixStrokeEngine& engine, const CalibrationResult& result);
+
+private:
+    using Vector = std::array<double, ParameterCount>;
+    using Matrix = std::array<Vector, ParameterCount>;
+
+    struct NormalEquations {
+        Matrix jtj{};
+        Vector jtr{};
+        double cost = 0;
+    };
+
+    NormalEquations evaluate(const Vector& scale) const;
+    void accumulate(const Vector& scale, std::size_t begin, std::size_t end, NormalEquations& out) const;
+    CalibrationResult make_result(const Vector& scale) const;
+
+    EngineParameters<double> parameters;
+    UpgradeEffect<double> upgrades;
+    UpgradeEffect<double> base_trim;
+    OperatingPoint<double> point;
+    std::vector<DynoSample> samples;
+    std::array<bool, ParameterCount> free;
+    unsigned thread_count;
+};
+
+#endif // ENGINE_CALIBRATION_H
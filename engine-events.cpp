@@ -0,0 +1,17 @@
+#include "engine-events.h"
+#include <cstring>
+
+std::string describe_engine_event(const EngineEvent& event) {
+    std::string name(event.name, strnlen(event.name, sizeof(event.name)));
+    switch (event.type) {
+    case EngineEventType::UpgradeApplied:
+        return name + " applied";
+    case EngineEventType::UnknownUpgrade:
+        return "Unknown upgrade: " + name;
+    case EngineEventType::WaterInjection:
+        return std::string("Water injection ") + (event.value ? "activated" : "deactivated");
+    case EngineEventType::TransmissionMode:
+        return std::string("Transmission mode switched to ") + (event.value ? "Manual" : "Automatic");
+    }
+    return std::string();
+}
@@ -0,0 +1,26 @@
+#ifndef ENGINE_EVENTS_H
+#define ENGINE_EVENTS_H
+
+#include <cstdint>
+#include <string>
+
+enum class EngineEventType : std::uint8_t {
+    UpgradeApplied,     // name: the upgrade
+    UnknownUpgrade,     // name: the rejected upgrade, cut to fit
+    WaterInjection,     // value: 1 when activated, 0 when deactivated
+    TransmissionMode    // value: 1 for manual, 0 for automatic
+};
+
+// Status change reported by the model. Fixed size and trivially copyable so
+// events can sit in a preallocated ring without allocating.
+struct EngineEvent {
+    EngineEventType type;
+    std::int32_t value;
+    double time;        // simulation time it happened at
+    char name[32];
+};
+
+// The console text the event used to be printed as
+std::string describe_engine_event(const EngineEvent& event);
+
+#endif // ENGINE_EVENTS_H
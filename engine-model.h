@@ -0,0 +1,156 @@
+#ifndef ENGINE_MODEL_H
+#define ENGINE_MODEL_H
+
+#include <cmath>
+#include <type_traits>
+
+#include "fast-math.h"
+
+// Core engine math, written once over a scalar type so the same equations can
+// be evaluated in double (the simulator), float (wide fleet batches) or
+// Dual<double, N> (exact parameter sensitivities).
+
+// Fixed geometry and calibration constants of an engine
+template <typename Scalar>
+struct EngineParameters {
+    Scalar bore;
+    Scalar stroke;
+    Scalar compression_ratio;
+    Scalar rod_length;
+    Scalar mean_effective_pressure;
+    Scalar optimal_temperature;
+    int num_cylinders;
+};
+
+// Combined multipliers of all active upgrades
+template <typename Scalar>
+struct UpgradeEffect {
+    Scalar power = Scalar(1);
+    Scalar thermal = Scalar(1);
+    Scalar volumetric = Scalar(1);
+    Scalar fuel = Scalar(1);
+    Scalar nox = Scalar(1);
+    Scalar temperature_offset = Scalar(0);
+
+    UpgradeEffect& operator*=(const UpgradeEffect& other) {
+        power *= other.power;
+        thermal *= other.thermal;
+        volumetric *= other.volumetric;
+        fuel *= other.fuel;
+        nox *= other.nox;
+        temperature_offset += other.temperature_offset;
+        return *this;
+    }
+};
+
+// State the performance metrics depend on at a given instant
+template <typename Scalar>
+struct OperatingPoint {
+    Scalar rpm;
+    Scalar engine_temperature;
+    Scalar volumetric_efficiency;
+    bool water_injection_active;
+};
+
+template <typename Scalar>
+struct PerformanceMetrics {
+    Scalar displacement;
+    Scalar rod_stroke_ratio;
+    Scalar piston_speed;
+    Scalar power_output;
+    Scalar torque;
+    Scalar thermal_efficiency;
+    Scalar fuel_consumption;
+    Scalar brake_specific_fuel_consumption;
+    Scalar co2_emissions;
+    Scalar nox_emissions;
+    Scalar volumetric_efficiency;
+    Scalar engine_temperature;
+};
+
+template <typename Scalar>
+class EngineModel {
+public:
+    static constexpr double PI = 3.14159265358979323846;
+
+    // x^exponent through libm or the fast approximation; dual numbers always use libm
+    static Scalar power(Scalar x, double exponent, MathMode mode) {
+        if constexpr (std::is_floating_point_v<Scalar>) {
+            if (mode == MathMode::Fast) {
+                return fast_pow(x, Scalar(exponent));
+            }
+        }
+        using std::pow;
+        return pow(x, Scalar(exponent));
+    }
+
+    static Scalar calculate_displacement(const EngineParameters<Scalar>& params) {
+        return Scalar(PI / 4.0) * params.bore * params.bore * params.stroke * Scalar(params.num_cylinders);
+    }
+
+    static Scalar calculate_power(Scalar mean_effective_pressure, Scalar displacement, Scalar rpm) {
+        return (mean_effective_pressure * displacement * rpm) / Scalar(120 * 1000);
+    }
+
+    static Scalar calculate_torque(Scalar power_output, Scalar rpm) {
+        return (power_output * Scalar(1000 * 60)) / (Scalar(2 * PI) * rpm);
+    }
+
+    static Scalar calculate_thermal_efficiency(Scalar compression_ratio, MathMode mode = MathMode::Libm) {
+        return Scalar(1) - Scalar(1) / power(compression_ratio, 1.4 - 1, mode);
+    }
+
+    static PerformanceMetrics<Scalar> update_performance(const EngineParameters<Scalar>& params,
+                                                         const UpgradeEffect<Scalar>& upgrades,
+                                                         const OperatingPoint<Scalar>& point,
+                                                         MathMode mode = MathMode::Libm) {
+        using std::abs;
+        PerformanceMetrics<Scalar> m;
+        m.displacement = calculate_displacement(params);
+        m.rod_stroke_ratio = params.rod_length / params.stroke;
+        m.piston_speed = (Scalar(2) * params.stroke * point.rpm) / Scalar(60.0);
+        m.power_output = calculate_power(params.mean_effective_pressure, m.displacement, point.rpm);
+        m.torque = calculate_torque(m.power_output, point.rpm);
+        m.thermal_efficiency = calculate_thermal_efficiency(params.compression_ratio, mode);
+
+        m.power_output *= upgrades.power;
+        m.thermal_efficiency *= upgrades.thermal;
+        m.volumetric_efficiency = point.volumetric_efficiency * upgrades.volumetric;
+        m.engine_temperature = point.engine_temperature + upgrades.temperature_offset;
+
+        // Update fuel consumption based on power output and efficiency
+        m.fuel_consumption = (m.power_output * Scalar(3600)) / (Scalar(43000) * m.thermal_efficiency) * upgrades.fuel; // Assuming gasoline with 43 MJ/kg energy density
+
+        m.brake_specific_fuel_consumption = (m.fuel_consumption * Scalar(3600)) / m.power_output;
+        m.co2_emissions = m.brake_specific_fuel_consumption * Scalar(3.2); // Approximate CO2 emissions for gasoline
+
+        // Update NOx emissions (simplified model)
+        m.nox_emissions = Scalar(0.01) * m.power_output * (Scalar(1) + (m.engine_temperature - Scalar(90)) / Scalar(100)) * upgrades.nox;
+
+        if (point.water_injection_active) {
+            m.thermal_efficiency *= Scalar(1.1);
+            m.nox_emissions *= Scalar(0.8);
+        }
+
+        Scalar temp_difference = abs(m.engine_temperature - params.optimal_temperature);
+        if (temp_difference > Scalar(10)) {
+            m.thermal_efficiency *= (Scalar(1) - Scalar(0.001) * temp_difference);
+        }
+
+        // Ensure volumetric efficiency stays within realistic bounds
+        if (m.volumetric_efficiency < Scalar(0.7)) {
+            m.volumetric_efficiency = Scalar(0.7);
+        }
+        else if (m.volumetric_efficiency > Scalar(1.0)) {
+            m.volumetric_efficiency = Scalar(1.0);
+        }
+        return m;
+    }
+
+    static Scalar calculate_vehicle_speed(Scalar rpm, Scalar gear_ratio, Scalar final_drive_ratio, Scalar wheel_radius) {
+        Scalar wheel_rpm = rpm / (gear_ratio * final_drive_ratio);
+        return (wheel_rpm * Scalar(2 * PI) * wheel_radius) / Scalar(60);
+    }
+};
+
+#endif // ENGINE_MODEL_H
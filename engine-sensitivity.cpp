@@ -0,0 +1,118 @@
+#include "engine-sensitivity.h"
+#include "six-stroke-engine.h"
+#include "dual-number.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <string>
+
+namespace {
+
+using SensitivityScalar = Dual<double, SensitivityReport::ParameterCount>;
+
+const char* const PARAMETER_NAMES[SensitivityReport::ParameterCount] = {
+    "bore", "stroke", "compression_ratio", "rod_length", "mean_effective_pressure",
+    "power_multiplier", "thermal_multiplier", "volumetric_multiplier", "fuel_multiplier", "nox_multiplier"
+};
+
+std::array<double, SensitivityReport::ParameterCount> elasticities(const SensitivityScalar& y,
+                                                                   const std::array<double, SensitivityReport::ParameterCount>& p) {
+    std::array<double, SensitivityReport::ParameterCount> e{};
+    for (int i = 0; i < SensitivityReport::ParameterCount; ++i) {
+        e[i] = y.value != 0 ? y.grad[i] * p[i] / y.value : 0.0;
+    }
+    return e;
+}
+
+void print_table(std::ostream& out, const std::string& title, const SensitivityReport& report,
+                 std::array<double, SensitivityReport::ParameterCount> SensitivityReport::Row::* column) {
+    out << "\n" << title << " elasticity (% change per 1% change in parameter)\n";
+    out << std::setw(8) << "rpm";
+    for (int i = 0; i < SensitivityReport::ParameterCount; ++i) {
+        out << std::setw(10) << std::string(PARAMETER_NAMES[i]).substr(0, 9);
+    }
+    out << "\n";
+
+    std::array<double, SensitivityReport::ParameterCount> mean_abs{};
+    for (const auto& row : report.rows) {
+        out << std::setw(8) << static_cast<int>(row.rpm);
+        for (int i = 0; i < SensitivityReport::ParameterCount; ++i) {
+            out << std::setw(10) << std::fixed << std::setprecision(3) << (row.*column)[i];
+            mean_abs[i] += std::abs((row.*column)[i]) / report.rows.size();
+        }
+        out << "\n";
+    }
+
+    std::array<int, SensitivityReport::ParameterCount> order;
+    for (int i = 0; i < SensitivityReport::ParameterCount; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return mean_abs[a] > mean_abs[b]; });
+    out << "Most influential:";
+    for (int i = 0; i < 3; ++i) {
+        out << " " << PARAMETER_NAMES[order[i]] << " (" << std::setprecision(3) << mean_abs[order[i]] << ")";
+    }
+    out << "\n";
+}
+
+} // namespace
+
+const char* SensitivityReport::parameter_name(int parameter) {
+    return PARAMETER_NAMES[parameter];
+}
+
+void SensitivityReport::print(std::ostream& out) const {
+    out << "Parameter sensitivity over " << rows.size() << " operating points\n";
+    for (int i = 0; i < ParameterCount; ++i) {
+        out << "  " << std::setw(24) << std::left << PARAMETER_NAMES[i] << std::right << parameter_values[i] << "\n";
+    }
+    print_table(out, "Power", *this, &Row::power);
+    print_table(out, "BSFC", *this, &Row::bsfc);
+    print_table(out, "NOx", *this, &Row::nox);
+}
+
+SensitivityReport compute_sensitivity_report(const SixStrokeEngine& engine, double rpm_min, double rpm_max, double rpm_step) {
+    using S = SensitivityScalar;
+    const EngineParameters<double> base = engine.model_parameters();
+    const UpgradeEffect<double>& effect = engine.upgrade_effect();
+    const OperatingPoint<double> point = engine.operating_point();
+
+    SensitivityReport report;
+    report.parameter_values = {
+        base.bore, base.stroke, base.compression_ratio, base.rod_length, base.mean_effective_pressure,
+        effect.power, effect.thermal, effect.volumetric, effect.fuel, effect.nox
+    };
+
+    // Seed every parameter as its own derivative direction: one evaluation
+    // per operating point yields the whole Jacobian row.
+    EngineParameters<S> params{
+        S::variable(base.bore, SensitivityReport::Bore),
+        S::variable(base.stroke, SensitivityReport::Stroke),
+        S::variable(base.compression_ratio, SensitivityReport::CompressionRatio),
+        S::variable(base.rod_length, SensitivityReport::RodLength),
+        S::variable(base.mean_effective_pressure, SensitivityReport::MeanEffectivePressure),
+        S(base.optimal_temperature),
+        base.num_cylinders
+    };
+    UpgradeEffect<S> upgrades;
+    upgrades.power = S::variable(effect.power, SensitivityReport::PowerMultiplier);
+    upgrades.thermal = S::variable(effect.thermal, SensitivityReport::ThermalMultiplier);
+    upgrades.volumetric = S::variable(effect.volumetric, SensitivityReport::VolumetricMultiplier);
+    upgrades.fuel = S::variable(effect.fuel, SensitivityReport::FuelMultiplier);
+    upgrades.nox = S::variable(effect.nox, SensitivityReport::NoxMultiplier);
+    upgrades.temperature_offset = S(effect.temperature_offset);
+
+    for (double rpm = rpm_min; rpm <= rpm_max; rpm += rpm_step) {
+        PerformanceMetrics<S> m = EngineModel<S>::update_performance(
+            params, upgrades, { S(rpm), S(point.engine_temperature), S(point.volumetric_efficiency), point.water_injection_active });
+
+        SensitivityReport::Row row;
+        row.rpm = rpm;
+        row.power_output = m.power_output.value;
+        row.brake_specific_fuel_consumption = m.brake_specific_fuel_consumption.value;
+        row.nox_emissions = m.nox_emissions.value;
+        row.power = elasticities(m.power_output, report.parameter_values);
+        row.bsfc = elasticities(m.brake_specific_fuel_consumption, report.parameter_values);
+        row.nox = elasticities(m.nox_emissions, report.parameter_values);
+        report.rows.push_back(row);
+    }
+    return report;
+}
@@ -0,0 +1,51 @@
+#ifndef ENGINE_SENSITIVITY_H
+#define ENGINE_SENSITIVITY_H
+
+#include <array>
+#include <ostream>
+#include <vector>
+
+class SixStrokeEngine;
+
+// Jacobian of power, BSFC and NOx with respect to the engine's geometry,
+// calibration and combined upgrade multipliers, evaluated with forward-mode
+// dual numbers so each operating point costs one model evaluation.
+struct SensitivityReport {
+    enum Parameter {
+        Bore,
+        Stroke,
+        CompressionRatio,
+        RodLength,
+        MeanEffectivePressure,
+        PowerMultiplier,
+        ThermalMultiplier,
+        VolumetricMultiplier,
+        FuelMultiplier,
+        NoxMultiplier,
+        ParameterCount
+    };
+
+    static const char* parameter_name(int parameter);
+
+    struct Row {
+        double rpm;
+        double power_output;
+        double brake_specific_fuel_consumption;
+        double nox_emissions;
+        // Elasticities d(ln y)/d(ln p): the % change in y per 1% change in p
+        std::array<double, ParameterCount> power;
+        std::array<double, ParameterCount> bsfc;
+        std::array<double, ParameterCount> nox;
+    };
+
+    std::array<double, ParameterCount> parameter_values;
+    std::vector<Row> rows;
+
+    void print(std::ostream& out) const;
+};
+
+// Evaluates the report at the engine's current temperature and upgrades for
+// every rpm in [rpm_min, rpm_max] spaced by rpm_step.
+SensitivityReport compute_sensitivity_report(const SixStrokeEngine& engine, double rpm_min, double rpm_max, double rpm_step);
+
+#endif // ENGINE_SENSITIVITY_H
@@ -0,0 +1,320 @@
+#include "engine-spec.h"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct NumberKey {
+    std::string_view name;
+    double EngineSpec::* field;
+};
+
+constexpr NumberKey NUMBER_KEYS[] = {
+    { "bore", &EngineSpec::bore },
+    { "stroke", &EngineSpec::stroke },
+    { "compression_ratio", &EngineSpec::compression_ratio },
+    { "rod_length", &EngineSpec::rod_length },
+    { "deck_height", &EngineSpec::deck_height },
+    { "idle_rpm", &EngineSpec::idle_rpm },
+    { "max_rpm", &EngineSpec::max_rpm },
+    { "mean_effective_pressure", &EngineSpec::mean_effective_pressure },
+    { "optimal_temperature", &EngineSpec::optimal_temperature },
+    { "vehicle_mass", &EngineSpec::vehicle_mass },
+};
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && is_space(s.front())) s.remove_prefix(1);
+    while (!s.empty() && is_space(s.back())) s.remove_suffix(1);
+    return s;
+}
+
+// Splits whitespace-separated numbers off the front of `s`
+template <typename T>
+bool next_number(std::string_view& s, T& value) {
+    s = trim(s);
+    if (s.empty()) {
+        return false;
+    }
+    auto result = std::from_chars(s.data(), s.data() + s.size(), value);
+    if (result.ec != std::errc() || (result.ptr != s.data() + s.size() && !is_space(*result.ptr))) {
+        return false;
+    }
+    s.remove_prefix(result.ptr - s.data());
+    return true;
+}
+
+template <typename T>
+bool number_list(std::string_view s, std::vector<T>& values) {
+    values.clear();
+    T value;
+    while (next_number(s, value)) {
+        values.push_back(value);
+    }
+    return trim(s).empty() && !values.empty();
+}
+
+// Parser state for the variant being filled in
+struct Variant {
+    EngineSpec spec;
+    bool firing_order_set = false;
+};
+
+// Returns an empty string when the key was applied, else what was wrong
+std::string apply_key(Variant& variant, std::string_view key, std::string_view value) {
+    EngineSpec& spec = variant.spec;
+    for (const NumberKey& number : NUMBER_KEYS) {
+        if (key == number.name) {
+            double v;
+            if (!next_number(value, v) || !trim(value).empty()) {
+                return "expected a number";
+            }
+            spec.*number.field = v;
+            return "";
+        }
+    }
+    if (key == "cylinders") {
+        int v;
+        if (!next_number(value, v) || !trim(value).empty()) {
+            return "expected an integer";
+        }
+        spec.num_cylinders = v;
+    }
+    else if (key == "firing_order") {
+        if (!number_list(value, spec.firing_order)) {
+            return "expected cylinder indices";
+        }
+        variant.firing_order_set = true;
+    }
+    else if (key == "gearbox") {
+        if (!find_gearbox_preset(std::string(value), spec.gearbox)) {
+            return "unknown gearbox preset";
+        }
+    }
+    else if (key == "gear_ratios") {
+        std::vector<double> ratios;
+        if (!number_list(value, ratios) || ratios.size() > GearboxSpec::MAX_GEARS) {
+            return "expected 1 to " + std::to_string(GearboxSpec::MAX_GEARS) + " ratios";
+        }
+        spec.gearbox.gear_count = static_cast<int>(ratios.size());
+        std::copy(ratios.begin(), ratios.end(), spec.gearbox.ratios);
+        if (spec.gearbox.type == GearboxType::Cvt) {
+            spec.gearbox.type = GearboxType::Stepped;
+        }
+    }
+    else if (key == "gearbox_type") {
+        if (value == "stepped") spec.gearbox.type = GearboxType::Stepped;
+        else if (value == "dct") spec.gearbox.type = GearboxType::DualClutch;
+        else if (value == "cvt") spec.gearbox.type = GearboxType::Cvt;
+        else return "expected stepped, dct or cvt";
+    }
+    else if (key == "cvt") {
+        double low, high;
+        int steps;
+        if (!next_number(value, low) || !next_number(value, high) || !next_number(value, steps) || !trim(value).empty()) {
+            return "expected low ratio, high ratio and step count";
+        }
+        spec.gearbox = GearboxSpec::cvt(low, high, steps, spec.gearbox.final_drive_ratio, spec.gearbox.wheel_radius);
+    }
+    else if (key == "final_drive" || key == "wheel_radius") {
+        double v;
+        if (!next_number(value, v) || !trim(value).empty()) {
+            return "expected a number";
+        }
+        (key == "final_drive" ? spec.gearbox.final_drive_ratio : spec.gearbox.wheel_radius) = v;
+    }
+    else {
+        return "unknown key";
+    }
+    return "";
+}
+
+std::string finish_variant(Variant& variant) {
+    EngineSpec& spec = variant.spec;
+    if (spec.num_cylinders < 1 || spec.num_cylinders > 64) {
+        return "cylinders must be 1 to 64";
+    }
+    if (!variant.firing_order_set && static_cast<int>(spec.firing_order.size()) != spec.num_cylinders) {
+        spec.firing_order.resize(spec.num_cylinders);
+        for (int i = 0; i < spec.num_cylinders; ++i) {
+            spec.firing_order[i] = i;
+        }
+    }
+    std::vector<int> sorted = spec.firing_order;
+    std::sort(sorted.begin(), sorted.end());
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        if (sorted[i] != static_cast<int>(i)) {
+            sorted.clear();
+            break;
+        }
+    }
+    if (static_cast<int>(sorted.size()) != spec.num_cylinders) {
+        return "firing_order must list each cylinder once";
+    }
+    if (!(spec.bore > 0 && spec.stroke > 0 && spec.rod_length > spec.stroke / 2 && spec.compression_ratio > 1 &&
+          spec.mean_effective_pressure > 0 && spec.vehicle_mass > 0)) {
+        return "geometry, pressure and mass must be positive, rod longer than the crank throw";
+    }
+    if (!(spec.idle_rpm > 0 && spec.idle_rpm < spec.max_rpm)) {
+        return "need 0 < idle_rpm < max_rpm";
+    }
+    if (!spec.gearbox.valid()) {
+        return "gearbox needs positive ratios, final drive and wheel radius";
+    }
+    return "";
+}
+
+// Shortest text that reads back as the same double
+void append_number(std::string& out, double value) {
+    char text[32];
+    auto result = std::to_chars(text, text + sizeof(text), value);
+    out.append(text, result.ptr);
+}
+
+} // namespace
+
+bool parse_engine_specs(const char* data, std::size_t size, const std::string& source,
+                        std::vector<EngineSpec>& specs, std::string& error) {
+    Variant defaults;
+    Variant current;
+    bool in_section = false;
+    int section_line = 0;
+
+    auto close_section = [&]() {
+        std::string message = finish_variant(current);
+        if (!message.empty()) {
+            error = source + ":" + std::to_string(section_line) + ": [" + current.spec.name + "] " + message;
+            return false;
+        }
+        specs.push_back(std::move(current.spec));
+        return true;
+    };
+
+    std::string_view text(data, size);
+    int line_number = 0;
+    while (!text.empty()) {
+        ++line_number;
+        std::size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        if (line.front() == '[') {
+            if (line.back() != ']' || line.size() < 3) {
+                error = source + ":" + std::to_string(line_number) + ": expected [name]";
+                return false;
+            }
+            if (in_section && !close_section()) {
+                return false;
+            }
+            current = defaults;
+            current.spec.name = std::string(trim(line.substr(1, line.size() - 2)));
+            in_section = true;
+            section_line = line_number;
+            continue;
+        }
+
+        std::size_t equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            error = source + ":" + std::to_string(line_number) + ": expected key = value";
+            return false;
+        }
+        std::string_view key = trim(line.substr(0, equals));
+        std::string message = apply_key(in_section ? current : defaults, key, trim(line.substr(equals + 1)));
+        if (!message.empty()) {
+            error = source + ":" + std::to_string(line_number) + ": " + std::string(key) + ": " + message;
+            return false;
+        }
+    }
+
+    if (in_section) {
+        return close_section();
+    }
+    current = defaults;
+    section_line = 1;
+    return close_section();
+}
+
+std::string format_engine_spec(const EngineSpec& spec) {
+    std::string out = "[" + spec.name + "]\n";
+    for (const NumberKey& number : NUMBER_KEYS) {
+        out.append(number.name).append(" = ");
+        append_number(out, spec.*number.field);
+        out += '\n';
+    }
+    out += "cylinders = " + std::to_string(spec.num_cylinders) + "\nfiring_order =";
+    for (int cylinder : spec.firing_order) {
+        out += ' ' + std::to_string(cylinder);
+    }
+    // Ratios before the type, since setting ratios turns a CVT back into a stepped box
+    out += "\ngear_ratios =";
+    for (int gear = 0; gear < spec.gearbox.gear_count; ++gear) {
+        out += ' ';
+        append_number(out, spec.gearbox.ratios[gear]);
+    }
+    const GearboxType type = spec.gearbox.type;
+    out += type == GearboxType::Cvt ? "\ngearbox_type = cvt" : type == GearboxType::DualClutch ? "\ngearbox_type = dct" : "\ngearbox_type = stepped";
+    out += "\nfinal_drive = ";
+    append_number(out, spec.gearbox.final_drive_ratio);
+    out += "\nwheel_radius = ";
+    append_number(out, spec.gearbox.wheel_radius);
+    out += '\n';
+    return out;
+}
+
+bool load_engine_specs(const std::string& path, std::vector<EngineSpec>& specs, std::string& error) {
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return parse_engine_specs(contents.data(), contents.size(), path, specs, error);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        error = "cannot stat " + path;
+        return false;
+    }
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    if (size == 0) {
+        close(fd);
+        return parse_engine_specs("", 0, path, specs, error);
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        // Pipes and some special files cannot be mapped
+        std::ifstream in(path, std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return parse_engine_specs(contents.data(), contents.size(), path, specs, error);
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    bool ok = parse_engine_specs(static_cast<const char*>(mapped), size, path, specs, error);
+    munmap(mapped, size);
+    return ok;
+#endif
+}
@@ -0,0 +1,54 @@
+#ifndef ENGINE_SPEC_H
+#define ENGINE_SPEC_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "gearbox.h"
+
+// Engine and vehicle definition. The defaults are the stock engine.
+struct EngineSpec {
+    std::string name = "default";
+    double bore = 0.086;                 // m
+    double stroke = 0.086;               // m
+    double compression_ratio = 11.0;
+    int num_cylinders = 3;
+    double rod_length = 0.143;           // m
+    double deck_height = 0.2;            // m
+    double idle_rpm = 800;
+    double max_rpm = 6000;
+    double mean_effective_pressure = 1000000; // Pa
+    double optimal_temperature = 90;     // degrees C
+    double vehicle_mass = 1500;          // kg
+    std::vector<int> firing_order = { 0, 2, 1 };
+    GearboxSpec gearbox = FIVE_SPEED_MANUAL;
+
+    bool operator==(const EngineSpec& other) const = default;
+};
+
+// Text format, one "key = value" per line, '#' starts a comment:
+//
+//   bore = 0.086                 # keys before any section are shared defaults
+//   [turbo-4]                    # each section is one variant
+//   cylinders = 4
+//   firing_order = 0 2 3 1
+//   gearbox = 6-speed            # a gearbox preset, then optional overrides:
+//   gear_ratios = 3.5 2.1 1.4 1.0 0.8
+//   gearbox_type = dct           # stepped, dct or cvt
+//   cvt = 2.6 0.42 24            # low ratio, high ratio, steps
+//   final_drive = 3.9
+//   wheel_radius = 0.31
+//
+// Other keys: stroke, compression_ratio, rod_length, deck_height, idle_rpm,
+// max_rpm, mean_effective_pressure, optimal_temperature, vehicle_mass.
+// A file without sections yields one spec. A variant that changes the
+// cylinder count without a firing order fires in index order.
+bool parse_engine_specs(const char* data, std::size_t size, const std::string& source,
+                        std::vector<EngineSpec>& specs, std::string& error);
+// One section in the format above that parses back to an equal spec
+std::string format_engine_spec(const EngineSpec& spec);
+// Maps the file read-only where the platform allows and parses it in place
+bool load_engine_specs(const std::string& path, std::vector<EngineSpec>& specs, std::string& error);
+
+#endif // ENGINE_SPEC_H
@@ -0,0 +1,25 @@
+#include "engine-state.h"
+#include <cstdio>
+#include <fstream>
+
+bool save_engine_snapshot(const std::string& path, const EngineSnapshot& snapshot) {
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out.write(reinterpret_cast<const char*>(&snapshot), sizeof(snapshot))) {
+            return false;
+        }
+    }
+#ifdef _WIN32
+    std::remove(path.c_str()); // rename() does not replace existing files on Windows
+#endif
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool load_engine_snapshot(const std::string& path, EngineSnapshot& snapshot) {
+    std::ifstream in(path, std::ios::binary);
+    return in.read(reinterpret_cast<char*>(&snapshot), sizeof(snapshot)) &&
+        snapshot.magic == EngineSnapshot::MAGIC &&
+        snapshot.version == EngineSnapshot::VERSION &&
+        snapshot.size == sizeof(EngineSnapshot);
+}
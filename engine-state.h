@@ -0,0 +1,69 @@
+#ifndef ENGINE_STATE_H
+#define ENGINE_STATE_H
+
+#include <cstdint>
+#include <string>
+
+// The engine's dynamic state alone. Restoring it keeps the engine's current
+// spec, upgrades and calibration, so it only reproduces a frame on an engine
+// configured the same way; EngineSnapshot carries the configuration too.
+struct EngineKeyState {
+    double rpm;
+    double engine_temperature;
+    double acceleration;
+    double jerk;
+    double volumetric_efficiency;
+    std::int32_t gear;
+    std::uint8_t water_injection_active;
+    std::uint8_t manual_transmission;
+    std::uint8_t reserved[2];
+};
+
+// Complete checkpoint of a SixStrokeEngine as one fixed-layout block, so a
+// snapshot is a single memcpy and a file write. Every field is 8 bytes wide
+// (the message buffer is a multiple of 8) so the layout has no padding and
+// can be diffed word by word. Bump VERSION on any layout change.
+struct EngineSnapshot {
+    static constexpr std::uint32_t MAGIC = 0x50534553; // "SESP"
+    static constexpr std::uint32_t VERSION = 5;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t size;
+
+    double simulation_time;
+    double rpm;
+    double engine_temperature;
+    double acceleration;
+    double jerk;
+    double volumetric_efficiency;
+    double water_injection_amount;
+    double gear_shift_message_timer;
+    double mean_effective_pressure;
+    double calibration_power;
+    double calibration_thermal;
+    double calibration_volumetric;
+    double calibration_fuel;
+    double calibration_nox;
+    double calibration_temperature_offset;
+    double crank_angle;
+    std::uint64_t upgrade_mask;
+    std::int64_t gear;
+    std::uint64_t water_injection_active;
+    std::uint64_t manual_transmission;
+    std::uint64_t random_state;
+    std::uint64_t cylinders_deactivated;
+    double deactivation_dwell;
+    std::uint64_t random_disturbances;
+    std::uint64_t fast_math;
+    char gear_shift_message[64];
+};
+
+static_assert(sizeof(EngineSnapshot) % sizeof(std::uint64_t) == 0, "EngineSnapshot must be a whole number of words");
+
+// Writes through a temporary file and renames it, so a crash mid-write
+// leaves the previous checkpoint intact
+bool save_engine_snapshot(const std::string& path, const EngineSnapshot& snapshot);
+bool load_engine_snapshot(const std::string& path, EngineSnapshot& snapshot);
+
+#endif // ENGINE_STATE_H
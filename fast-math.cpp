@@ -0,0 +1,66 @@
+#include "fast-math.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+
+void fast_pow_batch(const double* x, double exponent, double* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = fast_pow(x[i], exponent);
+    }
+}
+
+namespace {
+
+struct ReportCase {
+    const char* name;
+    double exponent;
+    double low;
+    double high;
+};
+
+} // namespace
+
+void print_fast_math_report(std::ostream& out) {
+    const ReportCase cases[] = {
+        { "compression_ratio^(gamma-1)", 0.4, 4.0, 25.0 },
+        { "volume_ratio^n (polytropic)", 1.3, 1.0, 25.0 },
+        { "volume_ratio^gamma", 1.4, 1.0, 25.0 },
+        { "pressure_ratio^((n-1)/n)", 0.3 / 1.3, 0.01, 200.0 },
+    };
+    const std::size_t samples = 1 << 20;
+
+    out << "Fast math accuracy vs libm (" << samples << " samples per case)\n";
+    out << std::setw(30) << std::left << "case" << std::right
+        << std::setw(14) << "max rel err" << std::setw(14) << "mean rel err"
+        << std::setw(12) << "libm ns" << std::setw(12) << "fast ns" << "\n";
+
+    std::vector<double> x(samples), reference(samples), approx(samples);
+    for (const ReportCase& c : cases) {
+        for (std::size_t i = 0; i < samples; ++i) {
+            x[i] = c.low + (c.high - c.low) * (static_cast<double>(i) + 0.5) / samples;
+        }
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        for (std::size_t i = 0; i < samples; ++i) {
+            reference[i] = std::pow(x[i], c.exponent);
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        fast_pow_batch(x.data(), c.exponent, approx.data(), samples);
+        auto t2 = std::chrono::high_resolution_clock::now();
+
+        double max_error = 0.0;
+        double sum_error = 0.0;
+        for (std::size_t i = 0; i < samples; ++i) {
+            double error = std::abs(approx[i] - reference[i]) / std::abs(reference[i]);
+            max_error = std::max(max_error, error);
+            sum_error += error;
+        }
+
+        double libm_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / samples;
+        double fast_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / samples;
+        out << std::setw(30) << std::left << c.name << std::right << std::scientific << std::setprecision(2)
+            << std::setw(14) << max_error << std::setw(14) << sum_error / samples
+            << std::fixed << std::setprecision(2) << std::setw(12) << libm_ns << std::setw(12) << fast_ns << "\n";
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Opt-in replacements for std::pow with the exponents the engine model uses
+// (gamma - 1 = 0.4 in the Otto efficiency, polytropic n ~ 1.3 in-cylinder).
+// Both helpers are straight-line code, so loops over them auto-vectorize.
+// For positive normal inputs the relative error of fast_pow is below 2e-9
+// times (1 + |exponent * ln x|); print_fast_math_report() measures it.
+
+enum class MathMode {
+    Libm,
+    Fast
+};
+
+// log2(x) for positive normal x: exponent bits plus a 2*atanh series on the
+// mantissa reduced to [sqrt(1/2), sqrt(2)), truncated after the s^9 term.
+inline double fast_log2(double x) {
+    std::uint64_t bits = std::bit_cast<std::uint64_t>(x);
+    std::uint64_t mantissa = bits & 0x000fffffffffffffull;
+    // Fold mantissas above sqrt(2) into [sqrt(1/2), 1) by borrowing one from the exponent
+    std::uint64_t high = static_cast<std::uint64_t>(mantissa > 0x6a09e667f3bcdull);
+    double m = std::bit_cast<double>(mantissa | ((0x3ffull - high) << 52));
+    // Biased exponent converted to double through the 2^52 bit pattern, which
+    // unlike an int64 conversion has a packed SSE2 form
+    double exponent = std::bit_cast<double>(0x4330000000000000ull | ((bits >> 52) + high)) - (4503599627370496.0 + 1023.0);
+
+    double s = (m - 1.0) / (m + 1.0);
+    double s2 = s * s;
+    double series = s * (2.0 + s2 * (2.0 / 3.0 + s2 * (2.0 / 5.0 + s2 * (2.0 / 7.0 + s2 * (2.0 / 9.0)))));
+    return exponent + series * 1.4426950408889634;
+}
+
+// 2^y via round-to-nearest split and a degree-8 Taylor polynomial of e^t on |t| <= ln(2)/2
+inline double fast_exp2(double y) {
+    // Adding 1.5 * 2^52 rounds y to the nearest integer k and leaves k in the low mantissa bits
+    double shifted = y + 6755399441055744.0;
+    double k = shifted - 6755399441055744.0;
+    double t = (y - k) * 0.6931471805599453;
+    double p = 1.0 + t * (1.0 + t * (1.0 / 2 + t * (1.0 / 6 + t * (1.0 / 24 + t * (1.0 / 120 +
+        t * (1.0 / 720 + t * (1.0 / 5040 + t * (1.0 / 40320))))))));
+    std::uint64_t scale = (std::bit_cast<std::uint64_t>(shifted) + 1023) << 52;
+    return p * std::bit_cast<double>(scale);
+}
+
+inline double fast_pow(double x, double exponent) {
+    return fast_exp2(exponent * fast_log2(x));
+}
+
+// Single-precision counterparts for float batches: the same reductions on the
+// 23-bit mantissa with the series cut to float accuracy, so they stay in
+// float lanes. Relative error of fast_pow is below 2e-7 times (1 + |exponent * ln x|).
+inline float fast_log2(float x) {
+    std::uint32_t bits = std::bit_cast<std::uint32_t>(x);
+    std::uint32_t mantissa = bits & 0x007fffffu;
+    std::uint32_t high = static_cast<std::uint32_t>(mantissa > 0x3504f3u);
+    float m = std::bit_cast<float>(mantissa | ((0x7fu - high) << 23));
+    float exponent = std::bit_cast<float>(0x4b000000u | ((bits >> 23) + high)) - (8388608.0f + 127.0f);
+
+    float s = (m - 1.0f) / (m + 1.0f);
+    float s2 = s * s;
+    float series = s * (2.0f + s2 * (2.0f / 3.0f + s2 * (2.0f / 5.0f + s2 * (2.0f / 7.0f))));
+    return exponent + series * 1.44269504f;
+}
+
+inline float fast_exp2(float y) {
+    float shifted = y + 12582912.0f;
+    float k = shifted - 12582912.0f;
+    float t = (y - k) * 0.693147181f;
+    float p = 1.0f + t * (1.0f + t * (1.0f / 2 + t * (1.0f / 6 + t * (1.0f / 24 + t * (1.0f / 120 +
+        t * (1.0f / 720 + t * (1.0f / 5040)))))));
+    std::uint32_t scale = (std::bit_cast<std::uint32_t>(shifted) + 127) << 23;
+    return p * std::bit_cast<float>(scale);
+}
+
+inline float fast_pow(float x, float exponent) {
+    return fast_exp2(exponent * fast_log2(x));
+}
+
+// out[i] = x[i]^exponent, vectorizable counterpart of a std::pow loop
+void fast_pow_batch(const double* x, double exponent, double* out, std::size_t n);
+
+// Max/mean relative error against std::pow and timing for each exponent the model uses
+void print_fast_math_report(std::ostream& out);
+
+#endif // FAST_MATH_H
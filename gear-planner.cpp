@@ -0,0 +1,250 @@
+#include "gear-planner.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+namespace {
+
+constexpr double INF = std::numeric_limits<double>::infinity();
+
+// Road load: rolling resistance, aerodynamic drag and driveline losses
+constexpr double GRAVITY = 9.81;
+constexpr double ROLLING_COEFFICIENT = 0.012;
+constexpr double DRAG_AREA = 0.7;        // Cd * A, m^2
+constexpr double AIR_DENSITY = 1.2;      // kg/m^3
+constexpr double DRIVELINE_EFFICIENCY = 0.92;
+
+// Runs body(begin, end) over [0, count) split across up to `threads` threads
+template <typename Body>
+void parallel_chunks(std::size_t count, unsigned threads, std::size_t min_chunk, Body body) {
+    std::size_t workers_needed = std::min<std::size_t>(threads, std::max<std::size_t>(1, count / min_chunk));
+    std::size_t chunk = (count + workers_needed - 1) / workers_needed;
+    std::vector<std::thread> workers;
+    for (std::size_t t = 1; t < workers_needed; ++t) {
+        std::size_t begin = std::min(count, t * chunk);
+        std::size_t end = std::min(count, begin + chunk);
+        workers.emplace_back([&body, begin, end]() { body(begin, end); });
+    }
+    body(0, std::min(count, chunk));
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace
+
+bool load_speed_trace_csv(const std::string& path, std::vector<SpeedTracePoint>& trace, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+        ++line_number;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        const char* p = line.c_str();
+        char* end = nullptr;
+        double time = std::strtod(p, &end);
+        bool ok = end != p;
+        p = end;
+        while (ok && (*p == ' ' || *p == '\t')) ++p;
+        ok = ok && *p++ == ',';
+        double speed = ok ? std::strtod(p, &end) : 0.0;
+        ok = ok && end != p;
+        if (!ok) {
+            if (line_number == 1) {
+                continue; // header
+            }
+            error = path + ":" + std::to_string(line_number) + ": expected time,speed";
+            return false;
+        }
+        if (!trace.empty() && time <= trace.back().time) {
+            error = path + ":" + std::to_string(line_number) + ": time must increase";
+            return false;
+        }
+        trace.push_back({ time, speed / 3.6 });
+    }
+    if (trace.size() < 2) {
+        error = path + ": need at least two samples";
+        return false;
+    }
+    return true;
+}
+
+GearPlanner::GearPlanner(const SixStrokeEngine& engine) :
+    parameters(engine.model_parameters()),
+    upgrades(engine.upgrade_effect()),
+    point(engine.operating_point()),
+    vehicle(engine.vehicle_parameters()),
+    shift_penalty(0.002),
+    thread_count(std::max(1u, std::thread::hardware_concurrency())),
+    rpm_step(10.0)
+{
+    point.water_injection_active = false;
+    build_map();
+}
+
+void GearPlanner::set_thread_count(unsigned threads) {
+    thread_count = std::max(1u, threads);
+}
+
+void GearPlanner::set_shift_penalty(double kilograms) {
+    shift_penalty = std::max(0.0, kilograms);
+}
+
+// Full-load power and specific fuel use from the engine model on a 10 rpm grid.
+// Friction grows with engine speed, which is what makes low rpm pay off.
+// Power is the model's calculate_power() per grid point, run over whole
+// arrays so the loops vectorize. At a fixed temperature and volumetric
+// efficiency the model's specific fuel use does not depend on rpm, so one
+// full evaluation gives it for the grid.
+void GearPlanner::build_map() {
+    const std::size_t points = static_cast<std::size_t>(std::ceil(vehicle.max_rpm / rpm_step)) + 2;
+    map_rpm.resize(points);
+    map_max_power.resize(points);
+    map_friction_power.resize(points);
+    map_fuel_per_kwh.resize(points);
+    const double displacement = EngineModel<double>::calculate_displacement(parameters);
+    const double mep = parameters.mean_effective_pressure;
+    const double power_upgrade = upgrades.power;
+    const PerformanceMetrics<double> reference = EngineModel<double>::update_performance(parameters, upgrades, point);
+    const double fuel_per_kwh = reference.fuel_consumption / reference.power_output;
+
+    parallel_chunks(points, thread_count, 256, [&](std::size_t begin, std::size_t end) {
+        double* rpm = map_rpm.data();
+        double* max_power = map_max_power.data();
+        double* friction_power = map_friction_power.data();
+        double* fuel = map_fuel_per_kwh.data();
+        for (std::size_t i = begin; i < end; ++i) {
+            rpm[i] = std::max(1.0, i * rpm_step);
+        }
+        for (std::size_t i = begin; i < end; ++i) {
+            max_power[i] = EngineModel<double>::calculate_power(mep, displacement, rpm[i]) * power_upgrade;
+        }
+        for (std::size_t i = begin; i < end; ++i) {
+            const double friction_mep = 97000.0 + 15.0 * rpm[i] + 0.005 * rpm[i] * rpm[i]; // Pa
+            friction_power[i] = EngineModel<double>::calculate_power(friction_mep, displacement, rpm[i]);
+        }
+        std::fill(fuel + begin, fuel + end, fuel_per_kwh);
+    });
+}
+
+GearPlanner::MapPoint GearPlanner::map_at(double rpm) const {
+    double position = std::min(rpm / rpm_step, static_cast<double>(map_rpm.size() - 2));
+    std::size_t i = static_cast<std::size_t>(position);
+    double f = position - i;
+    return { map_max_power[i] + f * (map_max_power[i + 1] - map_max_power[i]),
+             map_friction_power[i] + f * (map_friction_power[i + 1] - map_friction_power[i]),
+             map_fuel_per_kwh[i] + f * (map_fuel_per_kwh[i + 1] - map_fuel_per_kwh[i]) };
+}
+
+// Fuel burnt in each (step, gear) over the interval to the next trace point;
+// INF where the state is pruned. The last point ends the trace and burns
+// nothing, but is still checked against the load of the final interval.
+// unmet[t] is 1 when no gear meets the load and 2 when no gear is within
+// maximum rpm.
+void GearPlanner::stage_costs(const std::vector<SpeedTracePoint>& trace, std::size_t begin, std::size_t end,
+                              std::vector<double>& cost, std::vector<unsigned char>& unmet) const {
+    const std::size_t gears = vehicle.rpm_per_speed.size();
+    for (std::size_t t = begin; t < end; ++t) {
+        std::size_t next = std::min(t + 1, trace.size() - 1);
+        std::size_t previous = next - 1;
+        double dt = t + 1 < trace.size() ? trace[t + 1].time - trace[t].time : 0.0;
+        double speed = trace[t].speed;
+        double acceleration = (trace[next].speed - trace[previous].speed) / (trace[next].time - trace[previous].time);
+
+        double force = vehicle.vehicle_mass * (acceleration + GRAVITY * ROLLING_COEFFICIENT) +
+            0.5 * AIR_DENSITY * DRAG_AREA * speed * speed;
+        double road_power = force * speed / 1000.0 / DRIVELINE_EFFICIENCY; // kW
+
+        for (int pass = 0; pass < 2; ++pass) {
+            bool any = false;
+            for (std::size_t g = 0; g < gears; ++g) {
+                double rpm = speed * vehicle.rpm_per_speed[g];
+                // Below idle only first gear can pull away, with the clutch slipping
+                if (rpm < vehicle.idle_rpm) {
+                    rpm = g == 0 ? vehicle.idle_rpm : INF;
+                }
+                double fuel = INF;
+                if (rpm <= vehicle.max_rpm) {
+                    MapPoint m = map_at(rpm);
+                    if (pass == 1 || road_power <= m.max_power) {
+                        // Overrun cuts fuel entirely; otherwise burn for road load plus friction
+                        fuel = road_power < 0 ? 0.0 : (road_power + m.friction_power) * m.fuel_per_kwh * dt / 3600.0;
+                        any = true;
+                    }
+                }
+                cost[t * gears + g] = fuel;
+            }
+            // Second pass only when no gear meets the load: plan on rpm limits alone
+            unmet[t] = static_cast<unsigned char>(pass);
+            if (any) {
+                break;
+            }
+            // Over maximum rpm in every gear: no state is valid, so leave the
+            // step out of the fuel sum instead of making every path infinite
+            if (pass == 1) {
+                std::fill(cost.begin() + t * gears, cost.begin() + (t + 1) * gears, 0.0);
+                unmet[t] = 2;
+            }
+        }
+    }
+}
+
+GearPlan GearPlanner::plan(const std::vector<SpeedTracePoint>& trace) const {
+    const std::size_t steps = trace.size();
+    const std::size_t gears = vehicle.rpm_per_speed.size();
+    GearPlan result{ std::vector<int>(steps, 1), 0.0, 0, 0, {} };
+    // A single point has no interval to burn fuel over
+    if (steps < 2 || gears == 0) {
+        return result;
+    }
+
+    std::vector<double> cost(steps * gears);
+    std::vector<unsigned char> unmet(steps);
+    parallel_chunks(steps, thread_count, 1024, [&](std::size_t begin, std::size_t end) {
+        stage_costs(trace, begin, end, cost, unmet);
+    });
+
+    // Backward pass: value[g] is the least fuel from step t to the end in gear g
+    std::vector<double> value(gears, 0.0), next_value(gears);
+    std::vector<unsigned char> choice(steps * gears);
+    for (std::size_t t = steps; t-- > 0;) {
+        std::size_t best_next = 0;
+        if (t + 1 < steps) {
+            best_next = std::min_element(value.begin(), value.end()) - value.begin();
+        }
+        for (std::size_t g = 0; g < gears; ++g) {
+            double stay = t + 1 < steps ? value[g] : 0.0;
+            double shift = t + 1 < steps ? value[best_next] + shift_penalty : INF;
+            bool change = shift < stay;
+            choice[t * gears + g] = static_cast<unsigned char>(change ? best_next : g);
+            next_value[g] = cost[t * gears + g] + (change ? shift : stay);
+        }
+        value.swap(next_value);
+    }
+
+    // Forward pass from the best starting gear
+    std::size_t gear = std::min_element(value.begin(), value.end()) - value.begin();
+    for (std::size_t t = 0; t < steps; ++t) {
+        result.gears[t] = static_cast<int>(gear) + 1;
+        result.fuel += cost[t * gears + gear];
+        result.unmet_steps += unmet[t] == 1;
+        if (unmet[t] == 2) {
+            result.infeasible.push_back(t);
+            result.gears[t] = 0;
+        }
+        std::size_t next = choice[t * gears + gear];
+        result.shifts += next != gear && t + 1 < steps;
+        gear = next;
+    }
+    return result;
+}
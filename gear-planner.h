@@ -0,0 +1,71 @@
+#ifndef GEAR_PLANNER_H
+#define GEAR_PLANNER_H
+
+#include <string>
+#include <vector>
+
+#include "engine-model.h"
+#include "six-stroke-engine.h"
+
+struct SpeedTracePoint {
+    double time;   // s
+    double speed;  // m/s
+};
+
+// Reads "time,speed" rows with speed in km/h; a non-numeric first line is treated as a header.
+bool load_speed_trace_csv(const std::string& path, std::vector<SpeedTracePoint>& trace, std::string& error);
+
+struct GearPlan {
+    std::vector<int> gears;       // one per trace point, 0 where infeasible
+    double fuel;                  // kg over the whole trace
+    int shifts;
+    // Steps where no gear could deliver the road-load power; they were
+    // planned on rpm limits alone
+    std::size_t unmet_steps;
+    // Trace points too fast for every gear at maximum rpm. They cost no fuel
+    // and have gear 0, so `fuel` covers the rest of the trace.
+    std::vector<std::size_t> infeasible;
+};
+
+// Fuel-optimal gear sequence for a known speed trace by backward dynamic
+// programming over (time, gear). The engine map is tabulated once on an rpm
+// grid, as parallel arrays filled in vectorizable batches across threads,
+// and interpolated afterwards. States outside the idle to
+// maximum rpm band, or short of the road-load power, are pruned.
+class GearPlanner {
+public:
+    explicit GearPlanner(const SixStrokeEngine& engine);
+
+    void set_thread_count(unsigned threads);
+    // Fuel-equivalent cost of one gear change, in kg, to discourage hunting
+    void set_shift_penalty(double kilograms);
+    GearPlan plan(const std::vector<SpeedTracePoint>& trace) const;
+
+private:
+    struct MapPoint {
+        double max_power;      // kW at full load
+        double friction_power; // kW
+        double fuel_per_kwh;   // kg/kWh
+    };
+
+    void build_map();
+    MapPoint map_at(double rpm) const;
+    void stage_costs(const std::vector<SpeedTracePoint>& trace, std::size_t begin, std::size_t end,
+                     std::vector<double>& cost, std::vector<unsigned char>& unmet) const;
+
+    EngineParameters<double> parameters;
+    UpgradeEffect<double> upgrades;
+    OperatingPoint<double> point;
+    VehicleParameters vehicle;
+    double shift_penalty;
+    unsigned thread_count;
+
+    double rpm_step;
+    // The map by grid point, one array per quantity
+    std::vector<double> map_rpm;
+    std::vector<double> map_max_power;
+    std::vector<double> map_friction_power;
+    std::vector<double> map_fuel_per_kwh;
+};
+
+#endif // GEAR_PLANNER_H
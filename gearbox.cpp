@@ -0,0 +1,70 @@
+#include "gearbox.h"
+#include <algorithm>
+
+bool find_gearbox_preset(const std::string& name, GearboxSpec& spec) {
+    if (name == "5-speed") {
+        spec = FIVE_SPEED_MANUAL;
+    }
+    else if (name == "6-speed") {
+        spec = SIX_SPEED_MANUAL;
+    }
+    else if (name == "7-speed-dct") {
+        spec = SEVEN_SPEED_DCT;
+    }
+    else if (name == "cvt") {
+        spec = CVT_24_STEP;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+Gearbox::Gearbox() : Gearbox(FIVE_SPEED_MANUAL) {}
+
+Gearbox::Gearbox(const GearboxSpec& spec) :
+    gearbox_spec(spec),
+    gear_ratios(spec.ratios, spec.ratios + spec.gear_count),
+    current_gear(1)
+{
+    for (int gear = 1; gear <= spec.gear_count; ++gear) {
+        speed_factors.push_back(spec.speed_per_rpm(gear));
+        rpm_factors.push_back(spec.rpm_per_speed(gear));
+    }
+}
+
+double Gearbox::get_current_ratio() const {
+    return gear_ratios[current_gear - 1];
+}
+
+void Gearbox::shift_up() {
+    if (current_gear < gear_count()) {
+        current_gear++;
+    }
+}
+
+void Gearbox::shift_down() {
+    if (current_gear > 1) {
+        current_gear--;
+    }
+}
+
+int Gearbox::get_current_gear() const {
+    return current_gear;
+}
+
+void Gearbox::set_current_gear(int gear) {
+    current_gear = std::max(1, std::min(gear_count(), gear));
+}
+
+int Gearbox::gear_count() const {
+    return static_cast<int>(gear_ratios.size());
+}
+
+const std::vector<double>& Gearbox::get_gear_ratios() const {
+    return gear_ratios;
+}
+
+const GearboxSpec& Gearbox::spec() const {
+    return gearbox_spec;
+}
@@ -0,0 +1,120 @@
+#ifndef GEARBOX_H
+#define GEARBOX_H
+
+#include <string>
+#include <vector>
+
+enum class GearboxType {
+    Stepped,
+    DualClutch,
+    Cvt
+};
+
+// Driveline definition, ratios from first gear up. A CVT is discretized into
+// geometrically spaced ratio steps so the rest of the simulator can treat it
+// as a many-speed box. Dual-clutch boxes shift like stepped ones here, since
+// shifts are instantaneous in this model.
+struct GearboxSpec {
+    static constexpr int MAX_GEARS = 32;
+    static constexpr double PI = 3.14159265358979323846;
+
+    GearboxType type = GearboxType::Stepped;
+    int gear_count = 0;
+    double ratios[MAX_GEARS] = {};
+    double final_drive_ratio = 1.0;
+    double wheel_radius = 0.3;    // m
+
+    // Road speed in m/s per engine rpm, and its inverse, in `gear`
+    constexpr double speed_per_rpm(int gear) const {
+        return 2 * PI * wheel_radius / (60.0 * ratios[gear - 1] * final_drive_ratio);
+    }
+    constexpr double rpm_per_speed(int gear) const {
+        return 60.0 * ratios[gear - 1] * final_drive_ratio / (2 * PI * wheel_radius);
+    }
+
+    constexpr bool operator==(const GearboxSpec& other) const = default;
+
+    constexpr bool valid() const {
+        if (gear_count < 1 || gear_count > MAX_GEARS || !(final_drive_ratio > 0) || !(wheel_radius > 0)) {
+            return false;
+        }
+        for (int i = 0; i < gear_count; ++i) {
+            if (!(ratios[i] > 0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Continuously variable box between `low_ratio` (first step) and
+    // `high_ratio` (top step), each step the same factor apart
+    static constexpr GearboxSpec cvt(double low_ratio, double high_ratio, int steps,
+                                     double final_drive_ratio, double wheel_radius) {
+        GearboxSpec spec;
+        spec.type = GearboxType::Cvt;
+        spec.gear_count = steps < 1 ? 1 : (steps > MAX_GEARS ? MAX_GEARS : steps);
+        spec.final_drive_ratio = final_drive_ratio;
+        spec.wheel_radius = wheel_radius;
+        double step = spec.gear_count > 1 ? root(high_ratio / low_ratio, spec.gear_count - 1) : 1.0;
+        double ratio = low_ratio;
+        for (int i = 0; i < spec.gear_count; ++i) {
+            spec.ratios[i] = ratio;
+            ratio *= step;
+        }
+        return spec;
+    }
+
+private:
+    // x^(1/n) by Newton's method, usable in constant expressions
+    static constexpr double root(double x, int n) {
+        double r = x < 1 ? 1.0 : x;
+        for (int iteration = 0; iteration < 100; ++iteration) {
+            double p = 1;
+            for (int i = 1; i < n; ++i) p *= r;
+            double next = r - (p * r - x) / (n * p);
+            if (next == r) break;
+            r = next;
+        }
+        return r;
+    }
+};
+
+inline constexpr GearboxSpec FIVE_SPEED_MANUAL = { GearboxType::Stepped, 5, { 3.42, 2.14, 1.45, 1.0, 0.83 }, 3.73, 0.3175 };
+inline constexpr GearboxSpec SIX_SPEED_MANUAL = { GearboxType::Stepped, 6, { 3.73, 2.29, 1.52, 1.15, 0.92, 0.76 }, 3.65, 0.3175 };
+inline constexpr GearboxSpec SEVEN_SPEED_DCT = { GearboxType::DualClutch, 7, { 3.76, 2.27, 1.52, 1.13, 0.92, 0.76, 0.63 }, 3.65, 0.3175 };
+inline constexpr GearboxSpec CVT_24_STEP = GearboxSpec::cvt(2.63, 0.42, 24, 4.0, 0.3175);
+
+// Built-in presets by name: "5-speed", "6-speed", "7-speed-dct", "cvt"
+bool find_gearbox_preset(const std::string& name, GearboxSpec& spec);
+
+// Holds the current gear of a GearboxSpec. The rpm <-> road speed factors of
+// every gear are tabulated up front, so converting is a single multiply.
+class Gearbox {
+private:
+    GearboxSpec gearbox_spec;
+    std::vector<double> gear_ratios;
+    std::vector<double> speed_factors;  // m/s per rpm
+    std::vector<double> rpm_factors;    // rpm per m/s
+    int current_gear;
+
+public:
+    Gearbox();
+    explicit Gearbox(const GearboxSpec& spec);
+    double get_current_ratio() const;
+    void shift_up();
+    void shift_down();
+    int get_current_gear() const;
+    void set_current_gear(int gear);
+    int gear_count() const;
+    const std::vector<double>& get_gear_ratios() const;
+    const GearboxSpec& spec() const;
+
+    double speed_per_rpm() const { return speed_factors[current_gear - 1]; }
+    double rpm_per_speed() const { return rpm_factors[current_gear - 1]; }
+    const std::vector<double>& speed_per_rpm_table() const { return speed_factors; }
+    const std::vector<double>& rpm_per_speed_table() const { return rpm_factors; }
+    //void manual_shift_up();
+    //void manual_shift_down();
+};
+
+#endif // GEARBOX_H
@@ -1,10 +1,153 @@
 #include "six-stroke-engine.h"
+#include "engine-sensitivity.h"
+#include "engine-calibration.h"
+#include "fast-math.h"
+#include "gear-planner.h"
+#include "comparison-dashboard.h"
+#include "config-watcher.h"
+#include "run-summary.h"
+#include "telemetry-async.h"
+#include "telemetry-columnar.h"
+#include "telemetry-codec.h"
+#include "telemetry-index.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <random>
+#include <string>
 
-int main() {
-    SixStrokeEngine engine;
+namespace {
+
+constexpr double RECORD_STEP = 0.001; // s, fixed step of --record
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    auto has_flag = [&](const std::string& flag) {
+        return std::find(args.begin(), args.end(), flag) != args.end();
+    };
+    // Value following a flag, or null when the flag is absent or last
+    auto flag_value = [&](const std::string& flag) -> const char* {
+        auto it = std::find(args.begin(), args.end(), flag);
+        return (it != args.end() && it + 1 != args.end()) ? (it + 1)->c_str() : nullptr;
+    };
+
+    // --query <file> "<expression>"
+    auto query_flag = std::find(args.begin(), args.end(), "--query");
+    if (args.end() - query_flag > 2) {
+        TelemetryQuery query;
+        TelemetryQueryResult result;
+        std::string error;
+        if (!TelemetryQuery::parse(query_flag[2], query, error) ||
+            !run_telemetry_query(query_flag[1], query, result, error)) {
+            std::cout << "Query failed: " << error << std::endl;
+            return 1;
+        }
+        std::cout << result.rows_matched << " matching frames in " << result.match_intervals << " intervals";
+        if (result.rows_matched > 0) {
+            std::cout << " (t = " << result.first_match_time << " .. " << result.last_match_time << " s)";
+        }
+        std::cout << "\nScanned " << result.rows_scanned << " frames, skipped "
+            << result.chunks_skipped << " of " << result.chunks << " chunks by statistics\n";
+        return 0;
+    }
+
+    // --seek <compressed file> <seconds>: jump through the sparse index
+    auto seek_flag = std::find(args.begin(), args.end(), "--seek");
+    if (args.end() - seek_flag > 2) {
+        auto start = std::chrono::high_resolution_clock::now();
+        const std::string path = seek_flag[1];
+        const double target = std::atof(seek_flag[2].c_str());
+        TelemetryIndex index;
+        std::ifstream in(path, std::ios::binary);
+        TelemetryDecoder decoder;
+        if (!index.load(path + ".idx") || !decoder.open(in)) {
+            std::cout << "Cannot open " << path << " and its index" << std::endl;
+            return 1;
+        }
+        const TelemetryIndexEntry* entry = index.find(target);
+        if (!entry || !decoder.seek_block(static_cast<std::streamoff>(entry->offset))) {
+            std::cout << "Time " << target << " s is not in the recording" << std::endl;
+            return 1;
+        }
+
+        TelemetryFrame frame{};
+        bool found = false;
+        while (decoder.next(frame)) {
+            if (frame.time >= target) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            std::cout << "Time " << target << " s is past the end of the recording" << std::endl;
+            return 1;
+        }
+        double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "Seeked to t = " << frame.time << " s via snapshot at t = " << entry->time
+            << " s (" << index.size() << " index entries, " << elapsed_ms << " ms)\n";
+        std::cout << "rpm " << frame.rpm << ", gear " << frame.gear << ", temperature " << frame.engine_temperature
+            << ", speed " << frame.vehicle_speed * 3.6 << " km/h\n";
+
+        // Resume the recorded engine from the snapshot and replay up to the
+        // frame, which checks the index carries everything the run depends on
+        SixStrokeEngine resumed(index.spec());
+        if (const OperatingPointCacheConfig* cache = index.performance_cache()) {
+            resumed.enable_performance_cache(*cache);
+        }
+        if (!resumed.restore(entry->snapshot)) {
+            std::cout << "Index snapshot is from another version" << std::endl;
+            return 1;
+        }
+        resumed.clear_performance_cache();
+        long steps = std::lround((frame.time - entry->time) / RECORD_STEP);
+        for (long i = 0; i < steps; ++i) {
+            resumed.update_dynamics(RECORD_STEP);
+        }
+        // Compared at the codec's resolution, since the recording is quantized
+        TelemetryFrame replayed = resumed.sample_telemetry(resumed.get_simulation_time());
+        const TelemetryCodecConfig& codec = decoder.codec_config();
+        bool match = true;
+        for (int c = 0; c < TelemetryChannelCount; ++c) {
+            match = match && std::llround(telemetry_channel_value(replayed, c) / codec.resolution[c]) ==
+                std::llround(telemetry_channel_value(frame, c) / codec.resolution[c]);
+        }
+        std::cout << "Replayed " << steps << " steps from the snapshot: rpm " << replayed.rpm
+            << (match ? ", matches the recording\n" : ", differs from the recording\n");
+        return match ? 0 : 1;
+    }
+
+    // --engine <file> [--variant <name>]: engine and vehicle from a spec file,
+    // the first variant unless one is named
+    EngineSpec spec;
+    if (const char* path = flag_value("--engine")) {
+        std::vector<EngineSpec> specs;
+        std::string error;
+        auto start = std::chrono::steady_clock::now();
+        if (!load_engine_specs(path, specs, error)) {
+            std::cout << "Cannot load engine spec: " << error << std::endl;
+            return 1;
+        }
+        double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Loaded " << specs.size() << " engine variants in " << elapsed_ms << " ms\n";
+
+        auto chosen = specs.begin();
+        if (const char* name = flag_value("--variant")) {
+            chosen = std::find_if(specs.begin(), specs.end(), [&](const EngineSpec& s) { return s.name == name; });
+            if (chosen == specs.end()) {
+                std::cout << "No variant " << name << " in " << path << std::endl;
+                return 1;
+            }
+        }
+        spec = *chosen;
+    }
+
+    SixStrokeEngine engine(spec);
 
     std::cout << "Advanced Six-Stroke Engine Simulation with Gearbox\n";
     std::cout << "=================================================\n";
@@ -16,14 +159,339 @@ int main() {
         "variable_compression", "ceramic_coating"
     };
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 1);
+    // --upgrades a,b,c applies an explicit set ("" for stock). Without it the
+    // interactive session draws a random set, while the analysis modes use
+    // the stock engine so repeated runs give the same results.
+    const bool analysis = flag_value("--calibrate") || flag_value("--plan-gears") || flag_value("--record") ||
+        has_flag("--sensitivity");
+    if (const char* list = flag_value("--upgrades")) {
+        std::string upgrades = list;
+        for (std::size_t begin = 0; begin < upgrades.size();) {
+            std::size_t end = std::min(upgrades.find(',', begin), upgrades.size());
+            std::string upgrade = upgrades.substr(begin, end - begin);
+            if (!upgrade.empty() && std::find(available_upgrades.begin(), available_upgrades.end(), upgrade) == available_upgrades.end()) {
+                std::cout << "Unknown upgrade: " << upgrade << std::endl;
+                return 1;
+            }
+            if (!upgrade.empty()) {
+                engine.apply_upgrade(upgrade);
+            }
+            begin = end + 1;
+        }
+    }
+    else if (!analysis) {
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dis(0, 1);
+
+        for (const auto& upgrade : available_upgrades) {
+            if (dis(gen)) {
+                engine.apply_upgrade(upgrade);
+            }
+        }
+    }
+    EngineEvent applied[16];
+    for (std::size_t n = engine.drain_events(applied, 16); n > 0; n = engine.drain_events(applied, 16)) {
+        for (std::size_t i = 0; i < n; ++i) {
+            std::cout << describe_engine_event(applied[i]) << "\n";
+        }
+    }
+
+    if (const char* name = flag_value("--gearbox")) {
+        GearboxSpec spec;
+        if (!find_gearbox_preset(name, spec)) {
+            std::cout << "Unknown gearbox " << name << " (5-speed, 6-speed, 7-speed-dct, cvt)" << std::endl;
+            return 1;
+        }
+        engine.set_gearbox(spec);
+    }
+
+    // --compare "pkgA,pkgB;pkgC;": one engine per ';'-separated package of
+    // ','-separated upgrades (empty for stock), side by side on shared inputs
+    if (const char* list = flag_value("--compare")) {
+        std::vector<std::vector<std::string>> packages(1);
+        for (const char* c = list; *c; ++c) {
+            if (*c == ';') {
+                packages.emplace_back();
+            }
+            else if (*c == ',') {
+                packages.back().emplace_back();
+            }
+            else {
+                if (packages.back().empty()) {
+                    packages.back().emplace_back();
+                }
+                packages.back().back() += *c;
+            }
+        }
+        for (auto& package : packages) {
+            package.erase(std::remove(package.begin(), package.end(), std::string()), package.end());
+        }
+        EngineSpec compared = spec;
+        compared.gearbox = engine.get_gearbox().spec();
+        ComparisonDashboard dashboard(compared);
+        for (const auto& package : packages) {
+            std::string error;
+            if (!dashboard.add_package(package, error)) {
+                std::cout << "Cannot compare: " << error << std::endl;
+                return 1;
+            }
+        }
+        dashboard.run();
+        return 0;
+    }
+
+    // --calibration <file>: MEP and trims saved by --calibrate --calibration-output
+    if (const char* path = flag_value("--calibration")) {
+        CalibrationResult calibration;
+        std::string error;
+        if (!load_calibration(path, calibration, error)) {
+            std::cout << "Cannot load calibration: " << error << std::endl;
+            return 1;
+        }
+        CalibrationFitter::apply(engine, calibration);
+    }
+
+    if (const char* path = flag_value("--shift-map")) {
+        ShiftMap map;
+        std::string error;
+        if (!ShiftMap::load(path, map, error) || !engine.set_shift_map(map)) {
+            std::cout << "Cannot use shift map: " << (error.empty() ? "gear count does not match the gearbox" : error) << std::endl;
+            return 1;
+        }
+    }
+
+    // Deterministic dynamics: no random jerk or water injection toggling
+    if (has_flag("--no-disturbances")) {
+        engine.set_random_disturbances(false);
+    }
+
+    if (has_flag("--fast-math")) {
+        engine.set_math_mode(MathMode::Fast);
+    }
+
+    // Memoize performance metrics on quantized operating points
+    if (has_flag("--perf-cache")) {
+        engine.enable_performance_cache();
+    }
+
+    if (has_flag("--sensitivity")) {
+        compute_sensitivity_report(engine, 1000, 6000, 500).print(std::cout);
+        return 0;
+    }
+
+    if (has_flag("--fast-math-report")) {
+        print_fast_math_report(std::cout);
+        return 0;
+    }
+
+    if (const char* path = flag_value("--calibrate")) {
+        std::vector<DynoSample> samples;
+        std::string error;
+        if (!load_dyno_csv(path, samples, error)) {
+            std::cout << "Calibration failed: " << error << std::endl;
+            return 1;
+        }
+        CalibrationFitter fitter(engine, samples);
+        CalibrationResult result = fitter.fit();
+        std::cout << "Fitted " << samples.size() << " samples in " << result.iterations << " iterations"
+            << (result.converged ? "" : " (not converged)") << "\n";
+        std::cout << "Cost: " << result.initial_cost << " -> " << result.final_cost << "\n";
+        std::cout << "Mean effective pressure: " << result.mean_effective_pressure << " Pa\n";
+        std::cout << "Power trim: " << result.trim.power << "\n";
+        std::cout << "Thermal trim: " << result.trim.thermal << "\n";
+        std::cout << "Fuel trim: " << result.trim.fuel << "\n";
+        if (const char* output = flag_value("--calibration-output")) {
+            if (!save_calibration(output, result, error)) {
+                std::cout << "Cannot save calibration: " << error << std::endl;
+                return 1;
+            }
+            std::cout << "Saved to " << output << " (load with --calibration)\n";
+        }
+        return 0;
+    }
+
+    if (const char* path = flag_value("--plan-gears")) {
+        std::vector<SpeedTracePoint> trace;
+        std::string error;
+        if (!load_speed_trace_csv(path, trace, error)) {
+            std::cout << "Gear planning failed: " << error << std::endl;
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        GearPlanner planner(engine);
+        GearPlan plan = planner.plan(trace);
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "Planned " << trace.size() << " steps in " << elapsed << " ms\n";
+        std::cout << "Fuel: " << plan.fuel << " kg\n";
+        std::cout << "Shifts: " << plan.shifts << "\n";
+        if (plan.unmet_steps > 0) {
+            std::cout << "Steps short of road-load power: " << plan.unmet_steps << "\n";
+        }
+        if (!plan.infeasible.empty()) {
+            std::cout << "Infeasible trace points (above max rpm in every gear): " << plan.infeasible.size()
+                << ", first at t = " << trace[plan.infeasible.front()].time << " s; not included in the fuel\n";
+        }
+        std::vector<double> time_in_gear(engine.get_gearbox().gear_count(), 0.0);
+        for (std::size_t i = 0; i + 1 < trace.size(); ++i) {
+            if (plan.gears[i] > 0) {
+                time_in_gear[plan.gears[i] - 1] += trace[i + 1].time - trace[i].time;
+            }
+        }
+        for (std::size_t g = 0; g < time_in_gear.size(); ++g) {
+            std::cout << "Gear " << g + 1 << ": " << time_in_gear[g] << " s\n";
+        }
+
+        if (const char* output = flag_value("--plan-output")) {
+            std::ofstream out(output);
+            out << "time,speed,gear\n";
+            for (std::size_t i = 0; i < trace.size(); ++i) {
+                out << trace[i].time << "," << trace[i].speed * 3.6 << "," << plan.gears[i] << "\n";
+            }
+            if (!out) {
+                std::cout << "Cannot write " << output << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    if (const char* path = flag_value("--resume")) {
+        EngineSnapshot snapshot;
+        if (!load_engine_snapshot(path, snapshot) || !engine.restore(snapshot)) {
+            std::cout << "Cannot resume from " << path << std::endl;
+            return 1;
+        }
+        std::cout << "Resumed at t = " << engine.get_simulation_time() << " s\n";
+    }
+
+    if (const char* path = flag_value("--record")) {
+        // Headless 1 kHz run written to a columnar, or with --compress a
+        // delta-encoded, telemetry file. --checkpoint saves a snapshot every
+        // simulated second so the run can be resumed with --resume.
+        const char* seconds = flag_value("--seconds");
+        const char* checkpoint = flag_value("--checkpoint");
+        const double duration = seconds ? std::atof(seconds) : 60.0;
+        const double dt = RECORD_STEP;
+        // Ctrl+C ends the run early but still finishes the file
+        install_stop_handlers();
+        RunSummary summary;
+        auto step = [&](long frame) {
+            auto start = std::chrono::steady_clock::now();
+            engine.update_dynamics(dt);
+            if (checkpoint && frame % 1000 == 999) {
+                save_engine_snapshot(checkpoint, engine.snapshot());
+            }
+            summary.add_frame(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+                              dt, engine.sample_telemetry(engine.get_simulation_time()));
+        };
+        auto print_summary = [&]() {
+            if (const OperatingPointCache* cache = engine.performance_cache()) {
+                summary.set_cache_stats(cache->hits(), cache->misses());
+            }
+            summary.print(std::cout);
+        };
+
+        // --async: the compressed stream from a writer thread, without an
+        // index. --telemetry-policy block waits for queue space instead of
+        // dropping frames.
+        if (has_flag("--async")) {
+            AsyncTelemetryConfig config;
+            const char* policy = flag_value("--telemetry-policy");
+            if (policy && std::string(policy) == "block") {
+                config.policy = BackpressurePolicy::Block;
+            }
+            AsyncTelemetryWriter writer(config);
+            std::string error;
+            if (!writer.open(path, error)) {
+                std::cout << "Cannot write telemetry: " << error << std::endl;
+                return 1;
+            }
+            for (long frame = 0; engine.get_simulation_time() < duration && !stop_requested(); ++frame) {
+                step(frame);
+                writer.push(engine.sample_telemetry(engine.get_simulation_time()));
+            }
+            bool ok = writer.close(error);
+            AsyncTelemetryStats stats = writer.stats();
+            std::cout << stats.frames_written << " frames, " << stats.bytes_written << " bytes in " << stats.writes
+                << (stats.io_uring ? " io_uring" : " writev") << " writes, " << stats.frames_dropped << " dropped, "
+                << stats.blocked_pushes << " blocked\n";
+            if (!ok) {
+                std::cout << "Telemetry write failed: " << error << std::endl;
+            }
+            print_summary();
+            return ok ? 0 : 1;
+        }
+
+        if (has_flag("--compress")) {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            EngineSpec recorded = engine.loaded_spec();
+            recorded.gearbox = engine.get_gearbox().spec();
+            const std::string index_path = std::string(path) + ".idx";
+            const OperatingPointCacheConfig* cache = engine.performance_cache() ? &engine.performance_cache()->config() : nullptr;
+            TelemetryIndexWriter index(index_path, recorded, cache);
+            if (!out || !index.is_open()) {
+                std::cout << "Cannot write " << (out ? index_path : std::string(path)) << std::endl;
+                return 1;
+            }
+            TelemetryEncoder encoder;
+            std::vector<std::uint8_t> bytes;
+            for (long frame = 0; engine.get_simulation_time() < duration && !stop_requested(); ++frame) {
+                step(frame);
+                double time = engine.get_simulation_time();
+                if (encoder.at_block_start() && index.add_block(time, encoder.next_block_offset(), engine.snapshot())) {
+                    engine.clear_performance_cache();
+                }
+                if (encoder.append(engine.sample_telemetry(time))) {
+                    encoder.drain(bytes);
+                    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+                }
+            }
+            encoder.finish();
+            encoder.drain(bytes);
+            out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+            double raw = static_cast<double>(encoder.frames_encoded() * TelemetryChannelCount * sizeof(double));
+            std::cout << encoder.frames_encoded() << " frames, " << encoder.bytes_encoded() << " bytes ("
+                << raw / encoder.bytes_encoded() << "x smaller than raw doubles)\n";
+            out.flush();
+            bool index_ok = index.flush();
+            if (!out || !index_ok) {
+                std::cout << "Telemetry write failed: cannot write " << (out ? index_path : std::string(path)) << std::endl;
+            }
+            print_summary();
+            return out && index_ok ? 0 : 1;
+        }
+
+        ColumnarTelemetryWriter writer(path);
+        if (!writer.is_open()) {
+            std::cout << "Cannot write " << path << std::endl;
+            return 1;
+        }
+        for (long frame = 0; engine.get_simulation_time() < duration && !stop_requested(); ++frame) {
+            step(frame);
+            writer.append(engine.sample_telemetry(engine.get_simulation_time()));
+        }
+        bool ok = writer.flush();
+        if (!ok) {
+            std::cout << "Telemetry write failed: cannot write " << path << std::endl;
+        }
+        print_summary();
+        return ok ? 0 : 1;
+    }
 
-    for (const auto& upgrade : available_upgrades) {
-        if (dis(gen)) {
-            engine.apply_upgrade(upgrade);
+    // --watch: re-read the --engine spec file whenever it is saved
+    const char* spec_path = flag_value("--engine");
+    if (spec_path && has_flag("--watch")) {
+        const char* variant = flag_value("--variant");
+        ConfigWatcher watcher(spec_path, variant ? variant : "");
+        std::string error;
+        if (!watcher.start(error)) {
+            std::cout << "Cannot watch engine spec: " << error << std::endl;
+            return 1;
         }
+        engine.run_simulation(&watcher);
+        return 0;
     }
 
     engine.run_simulation();
@@ -0,0 +1,77 @@
+#include "operating-point-cache.h"
+#include <cmath>
+
+OperatingPointCache::OperatingPointCache(const OperatingPointCacheConfig& config) :
+    settings(config),
+    mask(0),
+    hit_count(0),
+    miss_count(0)
+{
+    std::size_t capacity = 1;
+    while (capacity < settings.capacity) {
+        capacity <<= 1;
+    }
+    settings.capacity = capacity;
+    entries.assign(capacity, Entry{});
+    mask = capacity - 1;
+}
+
+OperatingPointCache::Key OperatingPointCache::make_key(const OperatingPoint<double>& point, std::uint32_t upgrade_mask) const {
+    return {
+        static_cast<std::int32_t>(std::lround(point.rpm / settings.rpm_resolution)),
+        static_cast<std::int32_t>(std::lround(point.engine_temperature / settings.temperature_resolution)),
+        static_cast<std::int32_t>(std::lround(point.volumetric_efficiency / settings.volumetric_resolution)),
+        upgrade_mask,
+        point.water_injection_active
+    };
+}
+
+std::size_t OperatingPointCache::slot(const Key& key) const {
+    std::uint64_t h = static_cast<std::uint32_t>(key.rpm);
+    h = h * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint32_t>(key.temperature);
+    h = h * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint32_t>(key.volumetric);
+    h = h * 0x9E3779B97F4A7C15ull ^ key.upgrades;
+    h = h * 0x9E3779B97F4A7C15ull ^ (key.water_injection ? 1u : 0u);
+    return static_cast<std::size_t>(h ^ (h >> 29)) & mask;
+}
+
+const PerformanceMetrics<double>* OperatingPointCache::lookup(const OperatingPoint<double>& point, std::uint32_t upgrade_mask) {
+    Key key = make_key(point, upgrade_mask);
+    const Entry& entry = entries[slot(key)];
+    if (entry.valid && entry.key == key &&
+        std::abs(entry.rpm - point.rpm) <= settings.max_relative_error * point.rpm &&
+        std::abs(entry.engine_temperature - point.engine_temperature) <= settings.max_temperature_error) {
+        ++hit_count;
+        return &entry.metrics;
+    }
+    ++miss_count;
+    return nullptr;
+}
+
+void OperatingPointCache::insert(const OperatingPoint<double>& point, std::uint32_t upgrade_mask, const PerformanceMetrics<double>& metrics) {
+    Key key = make_key(point, upgrade_mask);
+    entries[slot(key)] = { key, point.rpm, point.engine_temperature, true, metrics };
+}
+
+void OperatingPointCache::clear() {
+    for (auto& entry : entries) {
+        entry.valid = false;
+    }
+}
+
+const OperatingPointCacheConfig& OperatingPointCache::config() const {
+    return settings;
+}
+
+std::uint64_t OperatingPointCache::hits() const {
+    return hit_count;
+}
+
+std::uint64_t OperatingPointCache::misses() const {
+    return miss_count;
+}
+
+double OperatingPointCache::hit_rate() const {
+    std::uint64_t total = hit_count + miss_count;
+    return total > 0 ? static_cast<double>(hit_count) / total : 0.0;
+}
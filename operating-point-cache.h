@@ -0,0 +1,68 @@
+#ifndef OPERATING_POINT_CACHE_H
+#define OPERATING_POINT_CACHE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "engine-model.h"
+
+struct OperatingPointCacheConfig {
+    double rpm_resolution = 10.0;
+    double temperature_resolution = 0.2;
+    double volumetric_resolution = 0.01;
+    double max_relative_error = 0.005;
+    double max_temperature_error = 0.05; // C
+    std::size_t capacity = 4096; // rounded up to a power of two
+};
+
+// Bounded, direct-mapped memo of performance metrics keyed on quantized
+// operating points. An entry is only reused when the rpm it was computed at
+// is within max_relative_error of the requested rpm (power, fuel and NOx all
+// scale linearly with rpm) and its temperature is within
+// max_temperature_error (NOx scales with temperature + 10 C, so 0.05 C stays
+// within 0.5% above 0 C). The resolutions set the bucket size and the error
+// bounds decide whether a bucket's contents are close enough. Volumetric
+// efficiency only passes through to the metrics and is recomputed exactly.
+class OperatingPointCache {
+public:
+    explicit OperatingPointCache(const OperatingPointCacheConfig& config = OperatingPointCacheConfig());
+
+    const PerformanceMetrics<double>* lookup(const OperatingPoint<double>& point, std::uint32_t upgrade_mask);
+    void insert(const OperatingPoint<double>& point, std::uint32_t upgrade_mask, const PerformanceMetrics<double>& metrics);
+    void clear();
+
+    const OperatingPointCacheConfig& config() const;
+    std::uint64_t hits() const;
+    std::uint64_t misses() const;
+    double hit_rate() const;
+
+private:
+    struct Key {
+        std::int32_t rpm;
+        std::int32_t temperature;
+        std::int32_t volumetric;
+        std::uint32_t upgrades;
+        bool water_injection;
+
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct Entry {
+        Key key;
+        double rpm;
+        double engine_temperature;
+        bool valid;
+        PerformanceMetrics<double> metrics;
+    };
+
+    Key make_key(const OperatingPoint<double>& point, std::uint32_t upgrade_mask) const;
+    std::size_t slot(const Key& key) const;
+
+    OperatingPointCacheConfig settings;
+    std::vector<Entry> entries;
+    std::size_t mask;
+    std::uint64_t hit_count;
+    std::uint64_t miss_count;
+};
+
+#endif // OPERATING_POINT_CACHE_H
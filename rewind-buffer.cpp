@@ -0,0 +1,157 @@
+#include "rewind-buffer.h"
+#include <algorithm>
+#include <cstring>
+
+RewindBuffer::RewindBuffer(std::size_t capacity, std::size_t keyframe_interval)
+    : keyframe_interval(std::max<std::size_t>(keyframe_interval, 1)),
+      segments((capacity + this->keyframe_interval - 1) / this->keyframe_interval + 1),
+      newest_segment(0), segment_count(0), frame_count(0), previous() {
+    // Delta storage grows with use rather than being reserved for the worst
+    // case (every word changing), which would cost more than full snapshots.
+    // A reused segment keeps its capacity, so pushes stop allocating once the
+    // buffer has wrapped.
+}
+
+void RewindBuffer::push(const EngineSnapshot& snapshot) {
+    if (segment_count == 0 || segments[newest_segment].frame_end.size() == keyframe_interval) {
+        if (segment_count > 0) {
+            newest_segment = (newest_segment + 1) % segments.size();
+        }
+        if (segment_count == segments.size()) {
+            frame_count -= segments[newest_segment].frame_end.size();
+        }
+        else {
+            ++segment_count;
+        }
+        Segment& s = segments[newest_segment];
+        s.keyframe = snapshot;
+        s.deltas.clear();
+        s.frame_end.clear();
+        s.frame_end.push_back(0);
+    }
+    else {
+        Segment& s = segments[newest_segment];
+        std::uint64_t current[WORDS], last[WORDS];
+        std::memcpy(current, &snapshot, sizeof(current));
+        std::memcpy(last, &previous, sizeof(last));
+
+        std::size_t mask_index = s.deltas.size();
+        std::uint64_t mask = 0;
+        s.deltas.push_back(0);
+        for (std::size_t i = 0; i < WORDS; ++i) {
+            std::uint64_t diff = current[i] ^ last[i];
+            if (diff != 0) {
+                mask |= std::uint64_t(1) << i;
+                s.deltas.push_back(diff);
+            }
+        }
+        s.deltas[mask_index] = mask;
+        s.frame_end.push_back(static_cast<std::uint32_t>(s.deltas.size()));
+    }
+    previous = snapshot;
+    ++frame_count;
+}
+
+const RewindBuffer::Segment& RewindBuffer::segment(std::size_t age) const {
+    return segments[(newest_segment + segments.size() - age) % segments.size()];
+}
+
+void RewindBuffer::reconstruct(const Segment& s, std::size_t frame, EngineSnapshot& snapshot) const {
+    std::uint64_t words[WORDS];
+    std::memcpy(words, &s.keyframe, sizeof(words));
+    std::size_t pos = 0;
+    const std::size_t end = s.frame_end[frame];
+    while (pos < end) {
+        const std::uint64_t mask = s.deltas[pos++];
+        for (std::size_t i = 0; i < WORDS; ++i) {
+            if ((mask >> i) & 1) {
+                words[i] ^= s.deltas[pos++];
+            }
+        }
+    }
+    std::memcpy(&snapshot, words, sizeof(words));
+}
+
+bool RewindBuffer::get(std::size_t frames_back, EngineSnapshot& snapshot) const {
+    if (frames_back >= frame_count) {
+        return false;
+    }
+    std::size_t age = 0;
+    while (frames_back >= segment(age).frame_end.size()) {
+        frames_back -= segment(age).frame_end.size();
+        ++age;
+    }
+    const Segment& s = segment(age);
+    reconstruct(s, s.frame_end.size() - 1 - frames_back, snapshot);
+    return true;
+}
+
+bool RewindBuffer::rewind(std::size_t frames, EngineSnapshot& snapshot) {
+    // Always keep the oldest frame so there is somewhere to land
+    frames = std::min(frames, frame_count - (frame_count > 0 ? 1 : 0));
+    if (!get(frames, snapshot)) {
+        return false;
+    }
+    while (frames > 0) {
+        Segment& s = segments[newest_segment];
+        std::size_t drop = std::min(frames, s.frame_end.size());
+        s.frame_end.resize(s.frame_end.size() - drop);
+        frames -= drop;
+        frame_count -= drop;
+        if (s.frame_end.empty()) {
+            newest_segment = (newest_segment + segments.size() - 1) % segments.size();
+            --segment_count;
+        }
+        else {
+            s.deltas.resize(s.frame_end.back());
+        }
+    }
+    previous = snapshot;
+    return true;
+}
+
+bool RewindBuffer::rewind_to_time(double time, EngineSnapshot& snapshot) {
+    if (frame_count == 0) {
+        return false;
+    }
+    // Smallest frames_back whose frame is at or before `time`
+    std::size_t low = 0;
+    std::size_t high = frame_count - 1;
+    EngineSnapshot probe{};
+    while (low < high) {
+        std::size_t middle = low + (high - low) / 2;
+        if (!get(middle, probe)) {
+            return false;
+        }
+        if (probe.simulation_time <= time) {
+            high = middle;
+        }
+        else {
+            low = middle + 1;
+        }
+    }
+    return rewind(low, snapshot);
+}
+
+void RewindBuffer::clear() {
+    for (auto& s : segments) {
+        s.deltas.clear();
+        s.frame_end.clear();
+    }
+    newest_segment = 0;
+    segment_count = 0;
+    frame_count = 0;
+}
+
+std::size_t RewindBuffer::size() const {
+    return frame_count;
+}
+
+// Everything allocated, including capacity not in use and segments not yet filled
+std::size_t RewindBuffer::memory_bytes() const {
+    std::size_t bytes = segments.capacity() * sizeof(Segment);
+    for (const Segment& s : segments) {
+        bytes += s.deltas.capacity() * sizeof(std::uint64_t) + s.frame_end.capacity() * sizeof(std::uint32_t);
+    }
+    return bytes;
+}
@@ -0,0 +1,58 @@
+#ifndef REWIND_BUFFER_H
+#define REWIND_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "engine-state.h"
+
+// Bounded history of engine snapshots for rewinding an interactive session.
+// Frames are grouped into segments that start with a full keyframe; every
+// other frame is stored as the XOR of its words with the previous frame,
+// keeping only a bit mask and the words that changed. Reconstructing a frame
+// replays at most one segment of deltas. The oldest segment is dropped once
+// the buffer is full, so at least `capacity` frames are always retained.
+class RewindBuffer {
+public:
+    explicit RewindBuffer(std::size_t capacity = 3600, std::size_t keyframe_interval = 60);
+
+    void push(const EngineSnapshot& snapshot);
+    // Frame `frames_back` frames before the newest one (0 = newest)
+    bool get(std::size_t frames_back, EngineSnapshot& snapshot) const;
+    // Discards the newest `frames` frames and returns the frame that is now
+    // newest, so recording continues from the rewound state
+    bool rewind(std::size_t frames, EngineSnapshot& snapshot);
+    // Rewinds to the newest frame at or before simulation time `time`, or to
+    // the oldest frame when all are later. Frames are pushed in time order
+    // but not at a fixed rate, so this searches their stored times.
+    bool rewind_to_time(double time, EngineSnapshot& snapshot);
+    void clear();
+
+    std::size_t size() const;
+    std::size_t memory_bytes() const;
+
+private:
+    static constexpr std::size_t WORDS = sizeof(EngineSnapshot) / sizeof(std::uint64_t);
+    static_assert(WORDS <= 64, "Delta mask must cover every snapshot word");
+
+    struct Segment {
+        EngineSnapshot keyframe;
+        // Per delta frame: a 64-bit change mask followed by the changed words
+        std::vector<std::uint64_t> deltas;
+        // End of each frame's delta in `deltas`; frame 0 is the keyframe
+        std::vector<std::uint32_t> frame_end;
+    };
+
+    const Segment& segment(std::size_t age) const;
+    void reconstruct(const Segment& segment, std::size_t frame, EngineSnapshot& snapshot) const;
+
+    std::size_t keyframe_interval;
+    std::vector<Segment> segments;
+    std::size_t newest_segment;
+    std::size_t segment_count;
+    std::size_t frame_count;
+    EngineSnapshot previous;
+};
+
+#endif // REWIND_BUFFER_H
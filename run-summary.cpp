@@ -0,0 +1,88 @@
+#include "run-summary.h"
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <iomanip>
+
+namespace {
+
+volatile std::sig_atomic_t stop_signal = 0;
+
+extern "C" void request_stop(int signal) {
+    stop_signal = signal;
+}
+
+} // namespace
+
+void install_stop_handlers() {
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+}
+
+bool stop_requested() {
+    return stop_signal != 0;
+}
+
+int RunSummary::frame_time_bucket(double seconds) {
+    if (!(seconds >= MIN_FRAME_TIME)) {
+        return 0;
+    }
+    int exponent;
+    double mantissa = std::frexp(seconds / MIN_FRAME_TIME, &exponent); // [0.5, 1)
+    int bucket = (exponent - 1) * SUB_BUCKETS + static_cast<int>((mantissa * 2 - 1) * SUB_BUCKETS);
+    return std::min(bucket, FRAME_TIME_BUCKETS - 1);
+}
+
+// Midpoint of the bucket
+double RunSummary::bucket_frame_time(int bucket) {
+    int octave = bucket / SUB_BUCKETS;
+    double sub = bucket % SUB_BUCKETS + 0.5;
+    return std::ldexp(MIN_FRAME_TIME * (1 + sub / SUB_BUCKETS), octave);
+}
+
+void RunSummary::add_frame(double frame_seconds, double dt, const TelemetryFrame& frame) {
+    ++frame_time_counts[frame_time_bucket(frame_seconds)];
+    ++frames;
+    frame_time_total += frame_seconds;
+    simulated_time += dt;
+    fuel += frame.fuel_consumption * dt / 3600.0;
+    distance += frame.vehicle_speed * dt;
+    if (frame.gear >= 1) {
+        if (time_in_gear.size() < static_cast<std::size_t>(frame.gear)) {
+            time_in_gear.resize(frame.gear, 0.0);
+        }
+        time_in_gear[frame.gear - 1] += dt;
+    }
+}
+
+void RunSummary::set_cache_stats(std::uint64_t hits, std::uint64_t misses) {
+    cache_hits = hits;
+    cache_misses = misses;
+}
+
+void RunSummary::print(std::ostream& out) const {
+    out << "Run summary\n";
+    out << "  Frames:          " << frames << "\n";
+    if (frames > 0) {
+        std::uint64_t rank = (frames - 1) * 99 / 100;
+        int p99 = 0;
+        for (std::uint64_t seen = frame_time_counts[0]; seen <= rank; seen += frame_time_counts[++p99]) {
+        }
+        out << "  Frame time:      " << std::fixed << std::setprecision(2) << frame_time_total / frames * 1e6
+            << " us avg, " << bucket_frame_time(p99) * 1e6 << " us p99\n";
+    }
+    out << std::fixed << std::setprecision(2);
+    out << "  Simulated time:  " << simulated_time << " s\n";
+    out << "  Fuel:            " << std::setprecision(4) << fuel << " kg\n";
+    out << "  Distance:        " << std::setprecision(2) << distance / 1000.0 << " km\n";
+    for (std::size_t g = 0; g < time_in_gear.size(); ++g) {
+        if (time_in_gear[g] > 0) {
+            out << "  Gear " << std::setw(2) << g + 1 << ":         " << time_in_gear[g] << " s\n";
+        }
+    }
+    if (cache_hits + cache_misses > 0) {
+        out << "  Perf cache:      " << cache_hits << " hits, " << cache_misses << " misses ("
+            << 100.0 * cache_hits / (cache_hits + cache_misses) << "%)\n";
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,116 @@
+#include "shift-map.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+constexpr double INF = std::numeric_limits<double>::infinity();
+
+} // namespace
+
+ShiftMap::ShiftMap() : ShiftMap(1, 0.0, 1.0, 1) {
+}
+
+ShiftMap::ShiftMap(int gears, double acceleration_min, double acceleration_max, int bins)
+    : gears(gears), bins(bins), last_bin(bins - 1), acceleration_min(acceleration_min),
+      inverse_bin_width(bins / (acceleration_max - acceleration_min)),
+      upshift_speed(static_cast<std::size_t>(gears) * bins, INF),
+      downshift_speed(static_cast<std::size_t>(gears) * bins, -INF) {
+}
+
+ShiftMap ShiftMap::from_rpm_lines(const std::vector<double>& speed_per_rpm, double upshift_rpm_min, double upshift_rpm_max,
+                                  double downshift_rpm_min, double downshift_rpm_max) {
+    const double acceleration_max = 50.0;
+    ShiftMap map(static_cast<int>(speed_per_rpm.size()), -acceleration_max, acceleration_max, 20);
+    for (int gear = 1; gear <= map.gears; ++gear) {
+        double factor = speed_per_rpm[gear - 1];
+        for (int bin = 0; bin < map.bins; ++bin) {
+            double acceleration = -acceleration_max + (bin + 0.5) * 2 * acceleration_max / map.bins;
+            double load = std::max(0.0, acceleration / acceleration_max);
+            std::size_t index = static_cast<std::size_t>(gear - 1) * map.bins + bin;
+            if (gear < map.gears) {
+                map.upshift_speed[index] = factor * (upshift_rpm_min + (upshift_rpm_max - upshift_rpm_min) * load);
+            }
+            if (gear > 1) {
+                map.downshift_speed[index] = factor * (downshift_rpm_min + (downshift_rpm_max - downshift_rpm_min) * load);
+            }
+        }
+    }
+    return map;
+}
+
+bool ShiftMap::load(const std::string& path, ShiftMap& map, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    struct Line {
+        bool up;
+        int gear;
+        std::vector<double> speeds;
+    };
+    std::vector<Line> lines;
+    double acceleration_min = 0, acceleration_max = 0;
+    int bins = 0;
+
+    std::string text;
+    int line_number = 0;
+    while (std::getline(in, text)) {
+        ++line_number;
+        std::istringstream fields(text);
+        std::string keyword;
+        if (!(fields >> keyword) || keyword[0] == '#') {
+            continue;
+        }
+        if (keyword == "acceleration_bins") {
+            if (!(fields >> acceleration_min >> acceleration_max >> bins) || bins < 1 || acceleration_max <= acceleration_min) {
+                error = path + ":" + std::to_string(line_number) + ": expected acceleration_bins <min> <max> <count>";
+                return false;
+            }
+        }
+        else if (keyword == "up" || keyword == "down") {
+            Line line{ keyword == "up", 0, {} };
+            double speed;
+            if (!(fields >> line.gear) || line.gear < 1) {
+                error = path + ":" + std::to_string(line_number) + ": expected a gear number";
+                return false;
+            }
+            while (fields >> speed) {
+                line.speeds.push_back(speed / 3.6);
+            }
+            lines.push_back(std::move(line));
+        }
+        else {
+            error = path + ":" + std::to_string(line_number) + ": unknown keyword " + keyword;
+            return false;
+        }
+    }
+    if (bins == 0) {
+        error = path + ": missing acceleration_bins";
+        return false;
+    }
+
+    int gears = 1;
+    for (const Line& line : lines) {
+        gears = std::max(gears, line.gear + (line.up ? 1 : 0));
+    }
+    ShiftMap result(gears, acceleration_min, acceleration_max, bins);
+    for (const Line& line : lines) {
+        if (static_cast<int>(line.speeds.size()) != bins) {
+            error = path + ": gear " + std::to_string(line.gear) + " needs " + std::to_string(bins) + " speeds";
+            return false;
+        }
+        std::vector<double>& table = line.up ? result.upshift_speed : result.downshift_speed;
+        std::copy(line.speeds.begin(), line.speeds.end(), table.begin() + static_cast<std::size_t>(line.gear - 1) * bins);
+    }
+    map = std::move(result);
+    return true;
+}
+
+int ShiftMap::gear_count() const {
+    return gears;
+}
@@ -0,0 +1,51 @@
+#ifndef SHIFT_MAP_H
+#define SHIFT_MAP_H
+
+#include <string>
+#include <vector>
+
+// Automatic shift schedule: per gear, upshift and downshift vehicle speeds
+// over evenly spaced acceleration bins, stored flat so a decision is one
+// index computation and two compares. Upshift lines above the top gear and
+// downshift lines below first gear are infinite, so no gear bounds checks.
+//
+// Text format (speeds in km/h, one value per acceleration bin):
+//   acceleration_bins <min> <max> <count>
+//   up <gear> <speed> ...
+//   down <gear> <speed> ...
+class ShiftMap {
+public:
+    ShiftMap();
+
+    // Thresholds where the engine reaches the given rpm in each gear, from the
+    // gearbox's road speed per rpm of every gear. The
+    // lines rise linearly from the *_min rpm at zero or negative acceleration
+    // to the *_max rpm at full acceleration, so hard driving holds gears longer.
+    static ShiftMap from_rpm_lines(const std::vector<double>& speed_per_rpm, double upshift_rpm_min, double upshift_rpm_max,
+                                   double downshift_rpm_min, double downshift_rpm_max);
+    static bool load(const std::string& path, ShiftMap& map, std::string& error);
+
+    // +1 to shift up, -1 to shift down, 0 to hold
+    int decide(int gear, double acceleration, double vehicle_speed) const {
+        double position = (acceleration - acceleration_min) * inverse_bin_width;
+        int bin = static_cast<int>(position < 0 ? 0 : (position > last_bin ? last_bin : position));
+        std::size_t index = static_cast<std::size_t>(gear - 1) * bins + bin;
+        return (vehicle_speed > upshift_speed[index]) - (vehicle_speed < downshift_speed[index]);
+    }
+
+    int gear_count() const;
+
+private:
+    ShiftMap(int gears, double acceleration_min, double acceleration_max, int bins);
+
+    int gears;
+    int bins;
+    double last_bin;
+    double acceleration_min;
+    double inverse_bin_width;
+    // m/s, indexed [(gear - 1) * bins + bin]
+    std::vector<double> upshift_speed;
+    std::vector<double> downshift_speed;
+};
+
+#endif // SHIFT_MAP_H
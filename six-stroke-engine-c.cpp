@@ -0,0 +1,133 @@
+#include "six-stroke-engine-c.h"
+#include "six-stroke-engine.h"
+#include "cosim-slave.h"
+#include <cstring>
+#include <new>
+
+static_assert(sizeof(six_stroke_engine_state) >= sizeof(EngineSnapshot), "C state buffer must hold an EngineSnapshot");
+
+struct six_stroke_engine {
+    SixStrokeEngine engine;
+    CoSimSlave slave{ engine };
+};
+
+int six_stroke_engine_abi_version(void) {
+    return SIX_STROKE_ENGINE_ABI_VERSION;
+}
+
+size_t six_stroke_engine_state_size(void) {
+    return sizeof(EngineSnapshot);
+}
+
+// The engine allocates (upgrade tables, messages); no exception may cross into C
+six_stroke_engine* six_stroke_engine_create(void) {
+    try {
+        six_stroke_engine* handle = new six_stroke_engine;
+        handle->engine.set_random_disturbances(false);
+        return handle;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void six_stroke_engine_destroy(six_stroke_engine* engine) {
+    delete engine;
+}
+
+int six_stroke_engine_apply_upgrade(six_stroke_engine* engine, const char* upgrade) {
+    try {
+        return upgrade && engine->engine.apply_upgrade(upgrade) ? SIX_STROKE_ENGINE_OK : SIX_STROKE_ENGINE_ERROR;
+    }
+    catch (...) {
+        return SIX_STROKE_ENGINE_OUT_OF_MEMORY;
+    }
+}
+
+void six_stroke_engine_set_random_disturbances(six_stroke_engine* engine, int enabled) {
+    engine->engine.set_random_disturbances(enabled != 0);
+}
+
+int six_stroke_engine_set_inputs(six_stroke_engine* engine, const six_stroke_engine_inputs* inputs) {
+    try {
+        SixStrokeEngine& e = engine->engine;
+        e.set_acceleration(inputs->acceleration);
+        e.set_water_injection(inputs->water_injection != 0);
+        e.set_manual_transmission(inputs->manual_transmission != 0);
+        if (inputs->shift_request > 0) {
+            e.manual_upshift();
+        }
+        else if (inputs->shift_request < 0) {
+            e.manual_downshift();
+        }
+        return SIX_STROKE_ENGINE_OK;
+    }
+    catch (...) {
+        return SIX_STROKE_ENGINE_OUT_OF_MEMORY;
+    }
+}
+
+int six_stroke_engine_step_many(six_stroke_engine* const* engines, size_t n, double dt,
+                                six_stroke_engine_metrics* out_metrics) {
+    try {
+        for (size_t i = 0; i < n; ++i) {
+            SixStrokeEngine& e = engines[i]->engine;
+            e.update_dynamics(dt);
+
+            TelemetryFrame frame = e.sample_telemetry(e.get_simulation_time());
+            six_stroke_engine_metrics& m = out_metrics[i];
+            m.rpm = frame.rpm;
+            m.torque = frame.torque;
+            m.power_output = frame.power_output;
+            m.fuel_consumption = frame.fuel_consumption;
+            m.thermal_efficiency = frame.thermal_efficiency;
+            m.brake_specific_fuel_consumption = frame.brake_specific_fuel_consumption;
+            m.nox_emissions = frame.nox_emissions;
+            m.engine_temperature = frame.engine_temperature;
+            m.vehicle_speed = frame.vehicle_speed;
+            m.gear = frame.gear;
+            m.water_injection_active = frame.water_injection_active;
+        }
+        return SIX_STROKE_ENGINE_OK;
+    }
+    catch (...) {
+        return SIX_STROKE_ENGINE_OUT_OF_MEMORY;
+    }
+}
+
+int six_stroke_engine_do_step(six_stroke_engine* engine, double current_time, double step_size) {
+    try {
+        return engine->slave.do_step(current_time, step_size) ? SIX_STROKE_ENGINE_OK : SIX_STROKE_ENGINE_ERROR;
+    }
+    catch (...) {
+        return SIX_STROKE_ENGINE_OUT_OF_MEMORY;
+    }
+}
+
+int six_stroke_engine_rollback(six_stroke_engine* engine) {
+    try {
+        return engine->slave.rollback() ? SIX_STROKE_ENGINE_OK : SIX_STROKE_ENGINE_ERROR;
+    }
+    catch (...) {
+        return SIX_STROKE_ENGINE_OUT_OF_MEMORY;
+    }
+}
+
+// Bytes past the snapshot are zeroed so states compare and hash consistently
+void six_stroke_engine_get_state(const six_stroke_engine* engine, six_stroke_engine_state* state) {
+    EngineSnapshot snapshot;
+    engine->slave.get_state(snapshot);
+    std::memcpy(state->bytes, &snapshot, sizeof(snapshot));
+    std::memset(state->bytes + sizeof(snapshot), 0, sizeof(state->bytes) - sizeof(snapshot));
+}
+
+int six_stroke_engine_set_state(six_stroke_engine* engine, const six_stroke_engine_state* state) {
+    try {
+        EngineSnapshot snapshot;
+        std::memcpy(&snapshot, state->bytes, sizeof(snapshot));
+        return engine->slave.set_state(snapshot) ? SIX_STROKE_ENGINE_OK : SIX_STROKE_ENGINE_ERROR;
+    }
+    catch (...) {
+        return SIX_STROKE_ENGINE_OUT_OF_MEMORY;
+    }
+}
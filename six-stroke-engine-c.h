@@ -0,0 +1,96 @@
+#ifndef SIX_STROKE_ENGINE_C_H
+#define SIX_STROKE_ENGINE_C_H
+
+/* Stable C interface to the six-stroke engine model for embedding in other
+ * simulators. Engines are opaque handles; a whole fleet is advanced with one
+ * six_stroke_engine_step_many() call per tick that writes into caller-owned
+ * arrays. Structs only ever grow at the end; check the ABI version at load. */
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#if defined(SIX_STROKE_ENGINE_BUILD_DLL)
+#define SIX_STROKE_ENGINE_API __declspec(dllexport)
+#else
+#define SIX_STROKE_ENGINE_API __declspec(dllimport)
+#endif
+#else
+#define SIX_STROKE_ENGINE_API __attribute__((visibility("default")))
+#endif
+
+#define SIX_STROKE_ENGINE_ABI_VERSION 2
+
+/* Return codes of the calls that can fail */
+#define SIX_STROKE_ENGINE_OK 0
+#define SIX_STROKE_ENGINE_ERROR (-1)
+#define SIX_STROKE_ENGINE_OUT_OF_MEMORY (-2)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct six_stroke_engine six_stroke_engine;
+
+/* Saved engine state for co-simulation rollback; plain bytes the host may copy.
+ * The buffer has room to spare so the engine state can grow without changing
+ * its size; six_stroke_engine_state_size() is the part in use. */
+#define SIX_STROKE_ENGINE_STATE_SIZE 512
+typedef struct six_stroke_engine_state {
+    unsigned char bytes[SIX_STROKE_ENGINE_STATE_SIZE];
+} six_stroke_engine_state;
+
+typedef struct six_stroke_engine_inputs {
+    double acceleration;      /* clamped to [-50, 50] */
+    int water_injection;      /* 0 or 1 */
+    int manual_transmission;  /* 0 = automatic, 1 = manual */
+    int shift_request;        /* manual only: +1 upshift, -1 downshift, 0 none */
+} six_stroke_engine_inputs;
+
+typedef struct six_stroke_engine_metrics {
+    double rpm;
+    double torque;
+    double power_output;
+    double fuel_consumption;
+    double thermal_efficiency;
+    double brake_specific_fuel_consumption;
+    double nox_emissions;
+    double engine_temperature;
+    double vehicle_speed;
+    int gear;
+    int water_injection_active;
+} six_stroke_engine_metrics;
+
+SIX_STROKE_ENGINE_API int six_stroke_engine_abi_version(void);
+/* Bytes of six_stroke_engine_state this library writes; never above SIX_STROKE_ENGINE_STATE_SIZE */
+SIX_STROKE_ENGINE_API size_t six_stroke_engine_state_size(void);
+
+/* New engine with random disturbances off, so runs are reproducible; null when
+ * out of memory. No call lets a C++ exception escape: the ones that can run
+ * out of memory return SIX_STROKE_ENGINE_OUT_OF_MEMORY. */
+SIX_STROKE_ENGINE_API six_stroke_engine* six_stroke_engine_create(void);
+SIX_STROKE_ENGINE_API void six_stroke_engine_destroy(six_stroke_engine* engine);
+
+/* Returns 0 on success, -1 for an unknown upgrade name, -2 when out of memory */
+SIX_STROKE_ENGINE_API int six_stroke_engine_apply_upgrade(six_stroke_engine* engine, const char* upgrade);
+SIX_STROKE_ENGINE_API void six_stroke_engine_set_random_disturbances(six_stroke_engine* engine, int enabled);
+SIX_STROKE_ENGINE_API int six_stroke_engine_set_inputs(six_stroke_engine* engine, const six_stroke_engine_inputs* inputs);
+
+/* Advances engines[0..n) by dt seconds and writes out_metrics[0..n) */
+SIX_STROKE_ENGINE_API int six_stroke_engine_step_many(six_stroke_engine* const* engines, size_t n, double dt,
+                                                      six_stroke_engine_metrics* out_metrics);
+
+/* Co-simulation step from current_time to current_time + step_size, split into
+ * internal steps of at most 1 ms. Returns 0 on success, -1 if current_time is
+ * not the engine's time or step_size <= 0, -2 when out of memory. */
+SIX_STROKE_ENGINE_API int six_stroke_engine_do_step(six_stroke_engine* engine, double current_time, double step_size);
+/* Undoes the last successful do_step; returns 0 on success */
+SIX_STROKE_ENGINE_API int six_stroke_engine_rollback(six_stroke_engine* engine);
+SIX_STROKE_ENGINE_API void six_stroke_engine_get_state(const six_stroke_engine* engine, six_stroke_engine_state* state);
+/* Returns 0 on success, -1 if the state is not from this library version */
+SIX_STROKE_ENGINE_API int six_stroke_engine_set_state(six_stroke_engine* engine, const six_stroke_engine_state* state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIX_STROKE_ENGINE_C_H */
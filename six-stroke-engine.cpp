@@ -1,10 +1,16 @@
 #include "six-stroke-engine.h"
+#include "rewind-buffer.h"
+#include "config-watcher.h"
+#include "terminal-events.h"
+#include "run-summary.h"
 #include <iostream>
 #include <iomanip>
 #include <thread>
 #include <chrono>
 #include <random>
 #include <cmath>
+#include <algorithm>
+#include <cstring>
 
 #ifdef _WIN32
 #include <conio.h>
@@ -26,132 +32,383 @@ const std::string MAGENTA = "\033[35m";
 const std::string CYAN = "\033[36m";
 const std::string WHITE = "\033[37m";
 
-Gearbox::Gearbox() : gear_ratios{ 3.42, 2.14, 1.45, 1.0, 0.83 }, current_gear(1) {}
+EngineParameters<double> SixStrokeEngine::model_parameters() const {
+    return { bore, stroke, compression_ratio, rod_length, mean_effective_pressure, optimal_temperature, num_cylinders };
+}
 
-double Gearbox::get_current_ratio() const {
-    return gear_ratios[current_gear - 1];
+VehicleParameters SixStrokeEngine::vehicle_parameters() const {
+    return { gearbox.rpm_per_speed_table(), vehicle_mass, idle_rpm, max_rpm };
 }
 
-void Gearbox::shift_up() {
-    if (current_gear < static_cast<int>(gear_ratios.size())) {
-        current_gear++;
-    }
+const UpgradeEffect<double>& SixStrokeEngine::upgrade_effect() const {
+    return active_upgrade_effect;
 }
 
-void Gearbox::shift_down() {
-    if (current_gear > 1) {
-        current_gear--;
-    }
+OperatingPoint<double> SixStrokeEngine::operating_point() const {
+    return { rpm, engine_temperature, volumetric_efficiency, water_injection_active };
 }
 
-int Gearbox::get_current_gear() const {
-    return current_gear;
+const UpgradeEffect<double>& SixStrokeEngine::calibration() const {
+    return calibration_trim;
 }
 
+void SixStrokeEngine::set_calibration(double mep, const UpgradeEffect<double>& trim) {
+    mean_effective_pressure = mep;
+    calibration_trim = trim;
+    if (operating_point_cache) {
+        operating_point_cache->clear();
+    }
+    update_upgrade_effect();
+    update_performance();
+}
 
-void SixStrokeEngine::calculate_displacement() {
-    displacement = (PI / 4.0) * pow(bore, 2) * stroke * num_cylinders;
+TelemetryFrame SixStrokeEngine::sample_telemetry(double time) const {
+    TelemetryFrame frame;
+    frame.time = time;
+    frame.rpm = rpm;
+    frame.torque = torque;
+    frame.power_output = power_output;
+    frame.engine_temperature = engine_temperature;
+    frame.gear = gearbox.get_current_gear();
+    frame.nox_emissions = nox_emissions;
+    frame.brake_specific_fuel_consumption = brake_specific_fuel_consumption;
+    frame.vehicle_speed = vehicle_speed;
+    frame.fuel_consumption = fuel_consumption;
+    frame.thermal_efficiency = thermal_efficiency;
+    frame.acceleration = acceleration;
+    frame.jerk = jerk;
+    frame.water_injection_active = water_injection_active;
+    frame.manual_transmission = transmission_mode == TransmissionMode::Manual;
+    return frame;
 }
 
-void SixStrokeEngine::calculate_rod_stroke_ratio() {
-    rod_stroke_ratio = rod_length / stroke;
+EngineKeyState SixStrokeEngine::key_state() const {
+    EngineKeyState state{};
+    state.rpm = rpm;
+    state.engine_temperature = engine_temperature;
+    state.acceleration = acceleration;
+    state.jerk = jerk;
+    state.volumetric_efficiency = volumetric_efficiency;
+    state.gear = gearbox.get_current_gear();
+    state.water_injection_active = water_injection_active;
+    state.manual_transmission = transmission_mode == TransmissionMode::Manual;
+    return state;
 }
 
-void SixStrokeEngine::calculate_piston_speed() {
-    piston_speed = (2 * stroke * rpm) / 60.0;
+void SixStrokeEngine::restore_key_state(const EngineKeyState& state) {
+    // update_performance() folds the upgrade temperature offset and volumetric
+    // multiplier into the state; undo them so recomputing lands on the recorded values
+    rpm = state.rpm;
+    engine_temperature = state.engine_temperature - active_upgrade_effect.temperature_offset;
+    acceleration = state.acceleration;
+    jerk = state.jerk;
+    volumetric_efficiency = state.volumetric_efficiency / active_upgrade_effect.volumetric;
+    gearbox.set_current_gear(state.gear);
+    water_injection_active = state.water_injection_active != 0;
+    transmission_mode = state.manual_transmission ? TransmissionMode::Manual : TransmissionMode::Automatic;
+    gear_shift_message.clear();
+    gear_shift_message_timer = 0.0;
+    update_performance();
+    update_vehicle_speed();
 }
 
-double SixStrokeEngine::calculate_power() const {
-    return (mean_effective_pressure * displacement * rpm) / (120 * 1000);
+double SixStrokeEngine::get_simulation_time() const {
+    return simulation_time;
 }
 
-double SixStrokeEngine::calculate_torque() const {
-    return (power_output * 1000 * 60) / (2 * PI * rpm);
+void SixStrokeEngine::set_simulation_time(double time) {
+    simulation_time = time;
 }
 
-double SixStrokeEngine::calculate_thermal_efficiency() const {
-    return 1 - 1 / pow(compression_ratio, 1.4 - 1);
+EngineSnapshot SixStrokeEngine::snapshot() const {
+    EngineSnapshot s{};
+    s.magic = EngineSnapshot::MAGIC;
+    s.version = EngineSnapshot::VERSION;
+    s.size = sizeof(EngineSnapshot);
+    s.simulation_time = simulation_time;
+    s.rpm = rpm;
+    s.engine_temperature = engine_temperature;
+    s.acceleration = acceleration;
+    s.jerk = jerk;
+    s.volumetric_efficiency = volumetric_efficiency;
+    s.water_injection_amount = water_injection_amount;
+    s.gear_shift_message_timer = gear_shift_message_timer;
+    s.mean_effective_pressure = mean_effective_pressure;
+    s.calibration_power = calibration_trim.power;
+    s.calibration_thermal = calibration_trim.thermal;
+    s.calibration_volumetric = calibration_trim.volumetric;
+    s.calibration_fuel = calibration_trim.fuel;
+    s.calibration_nox = calibration_trim.nox;
+    s.calibration_temperature_offset = calibration_trim.temperature_offset;
+    s.crank_angle = crank_angle;
+    s.upgrade_mask = active_upgrade_mask;
+    s.gear = gearbox.get_current_gear();
+    s.water_injection_active = water_injection_active;
+    s.manual_transmission = transmission_mode == TransmissionMode::Manual;
+    s.random_state = random_state;
+    s.cylinders_deactivated = cylinders_deactivated;
+    s.deactivation_dwell = deactivation_dwell;
+    s.random_disturbances = random_disturbances;
+    s.fast_math = math_mode == MathMode::Fast;
+    gear_shift_message.copy(s.gear_shift_message, sizeof(s.gear_shift_message) - 1);
+    return s;
 }
 
-void SixStrokeEngine::update_performance() {
-    calculate_displacement();
-    calculate_rod_stroke_ratio();
-    calculate_piston_speed();
-    power_output = calculate_power();
-    torque = calculate_torque();
-    thermal_efficiency = calculate_thermal_efficiency();
+bool SixStrokeEngine::restore(const EngineSnapshot& s) {
+    if (s.magic != EngineSnapshot::MAGIC || s.version != EngineSnapshot::VERSION || s.size != sizeof(EngineSnapshot)) {
+        return false;
+    }
+
+    if (s.random_disturbances != random_disturbances) {
+        random_disturbances = s.random_disturbances != 0;
+        quiescent = false;
+    }
+    if ((s.fast_math != 0) != (math_mode == MathMode::Fast)) {
+        set_math_mode(s.fast_math ? MathMode::Fast : MathMode::Libm);
+    }
+
+    UpgradeEffect<double> trim = { s.calibration_power, s.calibration_thermal, s.calibration_volumetric,
+                                   s.calibration_fuel, s.calibration_nox, s.calibration_temperature_offset };
+    // Rollbacks within one run keep the configuration; only rebuild it when it changed
+    if (s.upgrade_mask != active_upgrade_mask || s.mean_effective_pressure != mean_effective_pressure ||
+        std::memcmp(&trim, &calibration_trim, sizeof(trim)) != 0) {
+        int index = 0;
+        for (auto& [upgrade, is_active] : upgrades) {
+            is_active = (s.upgrade_mask >> index++) & 1;
+        }
+        mean_effective_pressure = s.mean_effective_pressure;
+        calibration_trim = trim;
+        if (operating_point_cache) {
+            operating_point_cache->clear();
+        }
+        update_upgrade_effect();
+    }
+
+    crank_angle = s.crank_angle;
+    // Before restore_key_state(), whose update_performance() applies it to the cylinder bank
+    cylinders_deactivated = s.cylinders_deactivated != 0;
+    deactivation_dwell = s.deactivation_dwell;
+
+    EngineKeyState state{};
+    state.rpm = s.rpm;
+    state.engine_temperature = s.engine_temperature;
+    state.acceleration = s.acceleration;
+    state.jerk = s.jerk;
+    state.volumetric_efficiency = s.volumetric_efficiency;
+    state.gear = static_cast<std::int32_t>(s.gear);
+    state.water_injection_active = s.water_injection_active != 0;
+    state.manual_transmission = s.manual_transmission != 0;
+    restore_key_state(state);
+
+    simulation_time = s.simulation_time;
+    water_injection_amount = s.water_injection_amount;
+    gear_shift_message.assign(s.gear_shift_message, strnlen(s.gear_shift_message, sizeof(s.gear_shift_message)));
+    gear_shift_message_timer = s.gear_shift_message_timer;
+    random_state = s.random_state;
+    return true;
+}
 
+void SixStrokeEngine::update_upgrade_effect() {
+    quiescent = false;
+    active_upgrade_effect = calibration_trim;
+    active_upgrade_mask = 0;
+    std::size_t index = 0;
     for (const auto& [upgrade, is_active] : upgrades) {
-        if (is_active && upgrade_effects.contains(upgrade)) {
-            upgrade_effects.at(upgrade)();
+        if (is_active) {
+            active_upgrade_effect *= effect_by_upgrade[index];
+            active_upgrade_mask |= 1u << index;
         }
+        ++index;
     }
+    cylinder_deactivation_enabled = (active_upgrade_mask & cylinder_deactivation_bit) != 0;
+}
+
+void SixStrokeEngine::enable_performance_cache(const OperatingPointCacheConfig& config) {
+    operating_point_cache.emplace(config);
+}
 
-    // Update fuel consumption based on power output and efficiency
-    fuel_consumption = (power_output * 3600) / (43000 * thermal_efficiency); // Assuming gasoline with 43 MJ/kg energy density
+void SixStrokeEngine::disable_performance_cache() {
+    operating_point_cache.reset();
+}
 
-    brake_specific_fuel_consumption = (fuel_consumption * 3600) / power_output;
-    co2_emissions = brake_specific_fuel_consumption * 3.2; // Approximate CO2 emissions for gasoline
+void SixStrokeEngine::clear_performance_cache() {
+    if (operating_point_cache) {
+        quiescent = false;
+        operating_point_cache->clear();
+        update_performance();
+    }
+}
 
-    // Update NOx emissions (simplified model)
-    nox_emissions = 0.01 * power_output * (1 + (engine_temperature - 90) / 100);
+const OperatingPointCache* SixStrokeEngine::performance_cache() const {
+    return operating_point_cache ? &*operating_point_cache : nullptr;
+}
 
-    if (water_injection_active) {
-        thermal_efficiency *= 1.1;
-        nox_emissions *= 0.8;
+void SixStrokeEngine::set_math_mode(MathMode mode) {
+    math_mode = mode;
+    quiescent = false;
+    if (operating_point_cache) {
+        operating_point_cache->clear();
     }
+    update_performance();
+}
 
-    double temp_difference = std::abs(engine_temperature - optimal_temperature);
-    if (temp_difference > 10) {
-        thermal_efficiency *= (1 - 0.001 * temp_difference);
+void SixStrokeEngine::update_performance() {
+    OperatingPoint<double> point = operating_point();
+    PerformanceMetrics<double> m;
+    const PerformanceMetrics<double>* cached = operating_point_cache ? operating_point_cache->lookup(point, active_upgrade_mask) : nullptr;
+    if (cached) {
+        // Temperature and volumetric efficiency carry over to the next frame,
+        // so they are recomputed exactly rather than taken from the bucket.
+        m = *cached;
+        m.engine_temperature = point.engine_temperature + active_upgrade_effect.temperature_offset;
+        m.volumetric_efficiency = std::min(std::max(point.volumetric_efficiency * active_upgrade_effect.volumetric, 0.7), 1.0);
+    }
+    else {
+        m = EngineModel<double>::update_performance(model_parameters(), active_upgrade_effect, point, math_mode);
+        if (operating_point_cache) {
+            operating_point_cache->insert(point, active_upgrade_mask, m);
+        }
     }
 
-    // Ensure volumetric efficiency stays within realistic bounds
-    volumetric_efficiency = std::min(std::max(volumetric_efficiency, 0.7), 1.0);
+    // Cylinder deactivation at light load (see update_cylinder_deactivation).
+    // The saving comes from lower pumping losses, so it scales with the share
+    // of cylinders shut off.
+    cylinder_bank.set_deactivated_count(cylinder_deactivation_enabled && cylinders_deactivated ? num_cylinders / 2 : 0);
+    const double fuel_factor = 1.0 - 0.24 * (num_cylinders - cylinder_bank.active_count()) / num_cylinders;
+    m.fuel_consumption *= fuel_factor;
+    m.brake_specific_fuel_consumption *= fuel_factor;
+    m.co2_emissions *= fuel_factor;
+
+    displacement = m.displacement;
+    rod_stroke_ratio = m.rod_stroke_ratio;
+    piston_speed = m.piston_speed;
+    power_output = m.power_output;
+    torque = m.torque;
+    thermal_efficiency = m.thermal_efficiency;
+    fuel_consumption = m.fuel_consumption;
+    brake_specific_fuel_consumption = m.brake_specific_fuel_consumption;
+    co2_emissions = m.co2_emissions;
+    nox_emissions = m.nox_emissions;
+    volumetric_efficiency = m.volumetric_efficiency;
+    engine_temperature = m.engine_temperature;
+    instantaneous_torque = cylinder_bank.update(crank_angle, torque);
 }
 
 
+// Half the cylinders shut off when not accelerating below 3300 rpm and come
+// back above 5 m/s^2 or 3700 rpm. Inside the band the state holds, and a
+// crossing has to last DEACTIVATION_DWELL seconds, so acceleration wandering
+// around zero does not switch it every frame.
+void SixStrokeEngine::update_cylinder_deactivation(double dt) {
+    if (!cylinder_deactivation_enabled) {
+        cylinders_deactivated = false;
+        deactivation_dwell = 0;
+        return;
+    }
+    bool wanted = cylinders_deactivated;
+    if (cylinders_deactivated && (acceleration > 5 || rpm > 3700)) {
+        wanted = false;
+    }
+    else if (!cylinders_deactivated && acceleration <= 0 && rpm < 3300) {
+        wanted = true;
+    }
+    if (wanted == cylinders_deactivated) {
+        deactivation_dwell = 0;
+        return;
+    }
+    deactivation_dwell += dt;
+    if (deactivation_dwell >= DEACTIVATION_DWELL) {
+        cylinders_deactivated = wanted;
+        deactivation_dwell = 0;
+    }
+}
+
 void SixStrokeEngine::update_vehicle_speed() {
-    double wheel_rpm = rpm / (gearbox.get_current_ratio() * final_drive_ratio);
-    vehicle_speed = (wheel_rpm * 2 * PI * wheel_radius) / 60;
-}
-
-SixStrokeEngine::SixStrokeEngine() :
-    bore(0.086),
-    stroke(0.086),
-    compression_ratio(11.0),
-    num_cylinders(3),
-    rpm(1000),
-    max_rpm(6000),
-    idle_rpm(800),
-    rod_length(0.143),
-    deck_height(0.2),
+    vehicle_speed = rpm * gearbox.speed_per_rpm();
+}
+
+// Changes gear at constant road speed, so rpm follows the ratio change
+void SixStrokeEngine::shift_to(int gear) {
+    double speed = rpm * gearbox.speed_per_rpm();
+    gearbox.set_current_gear(gear);
+    rpm = speed * gearbox.rpm_per_speed();
+    rpm = std::max(idle_rpm, std::min(max_rpm, rpm));
+}
+
+// Stepped boxes shift at 3500-4500 rpm and back down at 1800-2200 rpm
+// depending on acceleration. A CVT's steps are close enough to hold the
+// engine in a narrow band that rises with load.
+ShiftMap SixStrokeEngine::default_shift_map(const Gearbox& box) {
+    if (box.spec().type == GearboxType::Cvt) {
+        return ShiftMap::from_rpm_lines(box.speed_per_rpm_table(), 2400, 4500, 2000, 4000);
+    }
+    return ShiftMap::from_rpm_lines(box.speed_per_rpm_table(), 3500, 4500, 1800, 2200);
+}
+
+void SixStrokeEngine::apply_shift_map() {
+    update_vehicle_speed();
+    int decision = shift_map.decide(gearbox.get_current_gear(), acceleration, vehicle_speed);
+    if (decision != 0) {
+        shift_to(gearbox.get_current_gear() + decision);
+    }
+}
+
+SixStrokeEngine::SixStrokeEngine() : SixStrokeEngine(EngineSpec()) {}
+
+SixStrokeEngine::SixStrokeEngine(const EngineSpec& spec) :
+    bore(spec.bore),
+    stroke(spec.stroke),
+    compression_ratio(spec.compression_ratio),
+    num_cylinders(spec.num_cylinders),
+    rpm(std::max(1000.0, spec.idle_rpm)),
+    max_rpm(spec.max_rpm),
+    idle_rpm(spec.idle_rpm),
+    rod_length(spec.rod_length),
+    deck_height(spec.deck_height),
+    gear_shift_message_timer(0.0),
+    transmission_mode(TransmissionMode::Automatic),
+    current_fps(0),
+    dashboard_drawn(false),
+    simulation_time(0),
+    acceleration(0),
+    jerk(0),
     power_output(0),
     torque(0),
     fuel_consumption(0),
     thermal_efficiency(0),
     volumetric_efficiency(0.9),
-    mean_effective_pressure(1000000),
+    mean_effective_pressure(spec.mean_effective_pressure),
     nox_emissions(0.5),
     co2_emissions(0),
     brake_specific_fuel_consumption(0),
+    cylinder_deactivation_bit(0),
+    active_upgrade_mask(0),
+    math_mode(MathMode::Libm),
+    random_disturbances(true),
+    random_state(0),
+    events(256),
+    dropped_event_count(0),
+    quiescent(false),
     water_injection_active(false),
     water_injection_amount(0.005),
     engine_temperature(90),
-    optimal_temperature(90),
+    optimal_temperature(spec.optimal_temperature),
+    engine_spec(spec),
+    gearbox(spec.gearbox),
     vehicle_speed(0),
-    transmission_mode(TransmissionMode::Automatic),
-    gear_shift_message_timer(0.0),
-    wheel_radius(0.3175),
-    final_drive_ratio(3.73),
-    vehicle_mass(1500),
-    current_fps(0),
-    acceleration(0),
-    jerk(0)
+    vehicle_mass(spec.vehicle_mass),
+    cylinder_bank(model_parameters(), spec.firing_order),
+    crank_angle(0),
+    instantaneous_torque(0),
+    cylinder_deactivation_enabled(false),
+    cylinders_deactivated(false),
+    deactivation_dwell(0)
 {
-    calculate_displacement();
-    calculate_rod_stroke_ratio();
-    calculate_piston_speed();
+    shift_map = default_shift_map(gearbox);
+    set_random_seed(1);
+
+    // Room for any snapshot message, so restoring one never allocates
+    gear_shift_message.reserve(sizeof(EngineSnapshot::gear_shift_message));
 
     upgrades["direct_injection"] = false;
     upgrades["turbocharger"] = false;
@@ -165,61 +422,245 @@ SixStrokeEngine::SixStrokeEngine() :
     upgrades["variable_compression"] = false;
     upgrades["ceramic_coating"] = false;
 
-    upgrade_effects["direct_injection"] = [this]() {
-        fuel_consumption *= 0.9;
-        thermal_efficiency *= 1.05;
-        };
-    upgrade_effects["turbocharger"] = [this]() {
-        power_output *= 1.2;
-        volumetric_efficiency *= 1.15;
-        };
-    upgrade_effects["variable_valve_timing"] = [this]() {
-        volumetric_efficiency *= 1.1;
-        fuel_consumption *= 0.95;
-        };
-    upgrade_effects["exhaust_gas_recirculation"] = [this]() {
-        nox_emissions *= 0.7;
-        };
-    upgrade_effects["waste_heat_recovery"] = [this]() {
-        thermal_efficiency *= 1.05;
-        };
-    upgrade_effects["smart_cooling"] = [this]() {
-        thermal_efficiency *= 1.02;
-        };
-    upgrade_effects["advanced_materials"] = [this]() {
-        power_output *= 1.05;
-        };
-    upgrade_effects["enhanced_ecu"] = [this]() {
-        fuel_consumption *= 0.95;
-        power_output *= 1.05;
-        };
-    upgrade_effects["cylinder_deactivation"] = [this]() {
-        fuel_consumption *= 0.92;
-        };
-    upgrade_effects["variable_compression"] = [this]() {
-        thermal_efficiency *= 1.08;
-        fuel_consumption *= 0.93;
-        };
-    upgrade_effects["ceramic_coating"] = [this]() {
-        thermal_efficiency *= 1.03;
-        engine_temperature -= 5;
-        };
+    // Multipliers: power, thermal, volumetric, fuel, NOx, temperature offset
+    upgrade_effects["direct_injection"] = { 1.0, 1.05, 1.0, 0.9, 1.0, 0.0 };
+    upgrade_effects["turbocharger"] = { 1.2, 1.0, 1.15, 1.0, 1.0, 0.0 };
+    upgrade_effects["variable_valve_timing"] = { 1.0, 1.0, 1.1, 0.95, 1.0, 0.0 };
+    upgrade_effects["exhaust_gas_recirculation"] = { 1.0, 1.0, 1.0, 1.0, 0.7, 0.0 };
+    upgrade_effects["waste_heat_recovery"] = { 1.0, 1.05, 1.0, 1.0, 1.0, 0.0 };
+    upgrade_effects["smart_cooling"] = { 1.0, 1.02, 1.0, 1.0, 1.0, 0.0 };
+    upgrade_effects["advanced_materials"] = { 1.05, 1.0, 1.0, 1.0, 1.0, 0.0 };
+    upgrade_effects["enhanced_ecu"] = { 1.05, 1.0, 1.0, 0.95, 1.0, 0.0 };
+    upgrade_effects["cylinder_deactivation"] = { 1.0, 1.0, 1.0, 1.0, 1.0, 0.0 }; // Applied per cylinder in update_performance()
+    upgrade_effects["variable_compression"] = { 1.0, 1.08, 1.0, 0.93, 1.0, 0.0 };
+    upgrade_effects["ceramic_coating"] = { 1.0, 1.03, 1.0, 1.0, 1.0, -5.0 };
+
+    for (const auto& [upgrade, is_active] : upgrades) {
+        if (upgrade == "cylinder_deactivation") {
+            cylinder_deactivation_bit = 1u << effect_by_upgrade.size();
+        }
+        effect_by_upgrade.push_back(upgrade_effects.at(upgrade));
+    }
+
+    update_performance();
+    update_vehicle_speed();
+}
+
+void SixStrokeEngine::set_random_disturbances(bool enabled) {
+    random_disturbances = enabled;
+}
+
+void SixStrokeEngine::set_random_seed(std::uint64_t seed) {
+    // splitmix64 of the seed, so nearby seeds give unrelated streams and the state is never zero
+    std::uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    random_state = z != 0 ? z : 0x9E3779B97F4A7C15ull;
+}
+
+std::uint64_t SixStrokeEngine::next_random() {
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+    return (random_state * 0x2545F4914F6CDD1Dull) >> 32;
+}
+
+void SixStrokeEngine::emit(EngineEventType type, std::int32_t value, const std::string& name) {
+    EngineEvent event{};
+    event.type = type;
+    event.value = value;
+    event.time = simulation_time;
+    name.copy(event.name, sizeof(event.name) - 1);
+    if (!events.push(event)) {
+        dropped_event_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::size_t SixStrokeEngine::drain_events(EngineEvent* out, std::size_t max) {
+    return events.pop(out, max);
+}
+
+std::uint64_t SixStrokeEngine::dropped_events() const {
+    return dropped_event_count.load(std::memory_order_relaxed);
+}
+
+void SixStrokeEngine::set_acceleration(double value) {
+    acceleration = std::max(-50.0, std::min(50.0, value));
+}
+
+void SixStrokeEngine::set_water_injection(bool active) {
+    if (water_injection_active != active) {
+        water_injection_active = active;
+        update_performance();
+    }
+}
+
+void SixStrokeEngine::set_manual_transmission(bool manual) {
+    transmission_mode = manual ? TransmissionMode::Manual : TransmissionMode::Automatic;
+}
+
+bool SixStrokeEngine::set_gearbox(const GearboxSpec& spec) {
+    if (!spec.valid()) {
+        return false;
+    }
+    quiescent = false;
+    int gear = gearbox.get_current_gear();
+    gearbox = Gearbox(spec);
+    gearbox.set_current_gear(gear);
+    shift_map = default_shift_map(gearbox);
+    update_vehicle_speed();
+    return true;
+}
+
+bool SixStrokeEngine::apply_spec(const EngineSpec& spec) {
+    if (static_cast<int>(spec.firing_order.size()) != spec.num_cylinders || !spec.gearbox.valid()) {
+        return false;
+    }
+    quiescent = false;
+    const EngineSpec& old = engine_spec;
+    // Values already changed at runtime (calibrated MEP, a selected gearbox)
+    // are kept unless the file changes them too
+    bool geometry_changed = spec.bore != old.bore || spec.stroke != old.stroke || spec.rod_length != old.rod_length ||
+        spec.compression_ratio != old.compression_ratio || spec.num_cylinders != old.num_cylinders;
+    bool pressure_changed = spec.mean_effective_pressure != old.mean_effective_pressure;
+
+    bore = spec.bore;
+    stroke = spec.stroke;
+    compression_ratio = spec.compression_ratio;
+    num_cylinders = spec.num_cylinders;
+    rod_length = spec.rod_length;
+    deck_height = spec.deck_height;
+    idle_rpm = spec.idle_rpm;
+    max_rpm = spec.max_rpm;
+    optimal_temperature = spec.optimal_temperature;
+    vehicle_mass = spec.vehicle_mass;
+    if (pressure_changed) {
+        mean_effective_pressure = spec.mean_effective_pressure;
+    }
+    rpm = std::max(idle_rpm, std::min(max_rpm, rpm));
+
+    if (geometry_changed || pressure_changed || spec.optimal_temperature != old.optimal_temperature) {
+        if (operating_point_cache) {
+            operating_point_cache->clear();
+        }
+    }
+    if (geometry_changed || pressure_changed) {
+        cylinder_bank = CylinderBank(model_parameters(), spec.firing_order);
+    }
+    else if (spec.firing_order != old.firing_order) {
+        cylinder_bank.set_firing_order(spec.firing_order);
+    }
+    if (!(spec.gearbox == old.gearbox)) {
+        set_gearbox(spec.gearbox);
+    }
 
+    engine_spec = spec;
     update_performance();
     update_vehicle_speed();
+    return true;
+}
+
+const EngineSpec& SixStrokeEngine::loaded_spec() const {
+    return engine_spec;
+}
+
+const Gearbox& SixStrokeEngine::get_gearbox() const {
+    return gearbox;
+}
+
+bool SixStrokeEngine::set_shift_map(const ShiftMap& map) {
+    if (map.gear_count() != gearbox.gear_count()) {
+        return false;
+    }
+    quiescent = false;
+    shift_map = map;
+    return true;
+}
+
+const ShiftMap& SixStrokeEngine::get_shift_map() const {
+    return shift_map;
+}
+
+const CylinderBank& SixStrokeEngine::cylinders() const {
+    return cylinder_bank;
+}
+
+double SixStrokeEngine::get_crank_angle() const {
+    return crank_angle;
+}
+
+double SixStrokeEngine::get_instantaneous_torque() const {
+    return instantaneous_torque;
 }
 
 void SixStrokeEngine::toggle_transmission_mode() {
     transmission_mode = (transmission_mode == TransmissionMode::Automatic) ?
         TransmissionMode::Manual : TransmissionMode::Automatic;
-    std::cout << "Transmission mode switched to "
-        << (transmission_mode == TransmissionMode::Automatic ? "Automatic" : "Manual")
-        << std::endl;
+    emit(EngineEventType::TransmissionMode, transmission_mode == TransmissionMode::Manual);
+}
+
+SixStrokeEngine::DynamicState SixStrokeEngine::dynamic_state() const {
+    return { rpm, engine_temperature, volumetric_efficiency, acceleration, jerk, gearbox.get_current_gear(),
+             water_injection_active, transmission_mode == TransmissionMode::Manual, random_disturbances,
+             cylinders_deactivated, deactivation_dwell };
+}
+
+bool SixStrokeEngine::same_state(const DynamicState& a, const DynamicState& b) {
+    auto close = [](double x, double y) { return std::abs(x - y) <= 1e-9 * std::max(1.0, std::abs(x)); };
+    return close(a.rpm, b.rpm) && close(a.engine_temperature, b.engine_temperature) &&
+        close(a.volumetric_efficiency, b.volumetric_efficiency) && close(a.acceleration, b.acceleration) &&
+        close(a.jerk, b.jerk) && a.gear == b.gear && a.water_injection_active == b.water_injection_active &&
+        a.manual_transmission == b.manual_transmission && a.random_disturbances == b.random_disturbances &&
+        a.cylinders_deactivated == b.cylinders_deactivated && a.deactivation_dwell == b.deactivation_dwell;
+}
+
+// Inputs written directly (or through restore) show up as a changed state;
+// changes to upgrades, the model, the shift schedule or limits clear the flag
+bool SixStrokeEngine::is_quiescent() const {
+    return quiescent && same_state(dynamic_state(), quiescent_state);
+}
+
+void SixStrokeEngine::advance(double duration, double max_step) {
+    if (!(duration > 0)) {
+        return;
+    }
+    // A non-positive or NaN step would never finish; take the whole duration at once
+    if (!(max_step > 0)) {
+        max_step = duration;
+    }
+    const double steps = std::ceil(duration / max_step - 1e-9);
+    const double dt = duration / steps;
+    for (double i = 0; i < steps; ++i) {
+        if (is_quiescent()) {
+            update_dynamics((steps - i) * dt);
+            return;
+        }
+        update_dynamics(dt);
+    }
 }
 
 void SixStrokeEngine::update_dynamics(double dt) {
+    simulation_time += dt;
+    crank_angle = std::fmod(crank_angle + rpm * 6.0 * dt, CylinderBank::CYCLE_DEGREES);
+
+    if (is_quiescent()) {
+        instantaneous_torque = cylinder_bank.update(crank_angle, torque);
+        // Messages set without a state change (e.g. "Already in highest gear") still expire
+        if (gear_shift_message_timer > 0) {
+            gear_shift_message_timer -= dt;
+            if (gear_shift_message_timer <= 0) {
+                gear_shift_message.clear();
+            }
+        }
+        return;
+    }
+    const DynamicState before = dynamic_state();
+
     // Update jerk (rate of change of acceleration)
-    jerk += (std::rand() % 201 - 100) * dt; // Random jerk between -100 and 100
+    if (random_disturbances) {
+        jerk += (static_cast<int>(next_random() % 201) - 100) * dt; // Random jerk between -100 and 100
+    }
     jerk = std::max(-500.0, std::min(500.0, jerk)); // Limit jerk
 
     // Update acceleration
@@ -236,26 +677,20 @@ void SixStrokeEngine::update_dynamics(double dt) {
     engine_temperature = std::max(85.0, std::min(110.0, engine_temperature));
 
     // Randomly toggle water injection
-    if (std::rand() % 1000 < 5) { // 0.5% chance each frame
+    if (random_disturbances && next_random() % 1000 < 5) { // 0.5% chance each frame
         toggle_water_injection(!water_injection_active);
     }
 
     int previous_gear = gearbox.get_current_gear();
 
     if (transmission_mode == TransmissionMode::Automatic) {
-        if (rpm > 4000 && gearbox.get_current_gear() < 5) {
-            gearbox.shift_up();
-            rpm -= 1500;
-        }
-        else if (rpm < 2000 && gearbox.get_current_gear() > 1) {
-            gearbox.shift_down();
-            rpm += 1500;
-        }
+        apply_shift_map();
     }
 
     // Ensure RPM stays within bounds
     rpm = std::max(idle_rpm, std::min(max_rpm, rpm));
 
+    update_cylinder_deactivation(dt);
     update_performance();
     update_vehicle_speed();
 
@@ -270,6 +705,9 @@ void SixStrokeEngine::update_dynamics(double dt) {
             gear_shift_message.clear();
         }
     }
+
+    quiescent_state = dynamic_state();
+    quiescent = !random_disturbances && gear_shift_message_timer <= 0 && same_state(before, quiescent_state);
 }
 
 // Add this new method to calculate FPS
@@ -293,31 +731,32 @@ double SixStrokeEngine::calculate_fps() {
     return frame_times.size() / (total_time / 1000.0);
 }
 
-void SixStrokeEngine::apply_upgrade(const std::string& upgrade) {
+bool SixStrokeEngine::apply_upgrade(const std::string& upgrade) {
     if (upgrades.count(upgrade) > 0) {
         upgrades[upgrade] = true;
-        std::cout << upgrade << " applied\n";
+        emit(EngineEventType::UpgradeApplied, 1, upgrade);
+        update_upgrade_effect();
         update_performance();
+        return true;
     }
     else {
-        std::cout << "Unknown upgrade: " << upgrade << std::endl;
+        emit(EngineEventType::UnknownUpgrade, 0, upgrade);
+        return false;
     }
 }
 
 void SixStrokeEngine::toggle_water_injection(bool activate) {
     water_injection_active = activate;
-    std::cout << "Water injection " << (water_injection_active ? "activated" : "deactivated") << std::endl;
+    emit(EngineEventType::WaterInjection, water_injection_active);
     update_performance();
 }
 
 void SixStrokeEngine::simulate_performance() {
-    static bool first_run = true;
-
-    if (first_run) {
+    if (!dashboard_drawn) {
         std::cout << "\033[2J\033[H"; // Clear screen and move cursor to top-left
         std::cout << BOLD << BLUE << "Advanced Six-Stroke Engine Simulation\n" << RESET;
         std::cout << WHITE << std::string(50, '=') << RESET << "\n\n";
-        first_run = false;
+        dashboard_drawn = true;
     }
 
     auto print_label = [](const std::string& label, int row, int col) {
@@ -394,6 +833,12 @@ void SixStrokeEngine::simulate_performance() {
     print_label("Jerk:", 9, 42);
     print_value(std::to_string(jerk).substr(0, 6) + " m/s", BLUE, 9, 65);
 
+    print_label("Active Cylinders:", 10, 42);
+    print_value(std::to_string(cylinder_bank.active_count()) + " / " + std::to_string(num_cylinders), GREEN, 10, 65);
+
+    print_label("Crankshaft Torque:", 11, 42);
+    print_value(std::to_string(static_cast<int>(instantaneous_torque)) + " Nm", MAGENTA, 11, 65);
+
     // Controls reminder
     std::cout << "\033[16;2H" << WHITE << BOLD << "Controls: " << RESET
         << "a: Accelerate | d: Decelerate | e: Upshift | q: Downshift | Ctrl+C: Exit";
@@ -416,13 +861,9 @@ void SixStrokeEngine::accelerate() {
         engine_temperature = 110; // Cap maximum temperature
     }
 
+    apply_shift_map();
     update_performance();
     update_vehicle_speed();
-
-    if (rpm > 4000 && gearbox.get_current_gear() < 5) {
-        gearbox.shift_up();
-        rpm -= 1500;
-    }
 }
 
 void SixStrokeEngine::decelerate() {
@@ -439,13 +880,9 @@ void SixStrokeEngine::decelerate() {
         engine_temperature = 85; // Cap minimum temperature
     }
 
+    apply_shift_map();
     update_performance();
     update_vehicle_speed();
-
-    if (rpm < 2000 && gearbox.get_current_gear() > 1) {
-        gearbox.shift_down();
-        rpm += 1500;
-    }
 }
 
 /*void Gearbox::manual_shift_up() {
@@ -471,10 +908,8 @@ void Gearbox::manual_shift_down() {
 void SixStrokeEngine::manual_upshift() {
     if (transmission_mode == TransmissionMode::Manual) {
         int previous_gear = gearbox.get_current_gear();
-        gearbox.shift_up();
+        shift_to(previous_gear + 1);
         if (gearbox.get_current_gear() != previous_gear) {
-            rpm -= 1500; // Simulate rpm drop after upshift
-            rpm = std::max(rpm, idle_rpm);
             gear_shift_message = "Manually shifted up to gear " + std::to_string(gearbox.get_current_gear());
             gear_shift_message_timer = 3.0; // Display message for 3 seconds
         }
@@ -488,10 +923,8 @@ void SixStrokeEngine::manual_upshift() {
 void SixStrokeEngine::manual_downshift() {
     if (transmission_mode == TransmissionMode::Manual) {
         int previous_gear = gearbox.get_current_gear();
-        gearbox.shift_down();
+        shift_to(previous_gear - 1);
         if (gearbox.get_current_gear() != previous_gear) {
-            rpm += 1500; // Simulate rpm increase after downshift
-            rpm = std::min(rpm, max_rpm);
             gear_shift_message = "Manually shifted down to gear " + std::to_string(gearbox.get_current_gear());
             gear_shift_message_timer = 3.0; // Display message for 3 seconds
         }
@@ -549,51 +982,133 @@ char get_user_input() {
     return 0;
 }
 
-void SixStrokeEngine::run_simulation() {
+void SixStrokeEngine::run_simulation(ConfigWatcher* config) {
     std::cout << "Running real-time simulation at 60 FPS. Controls:\n";
     std::cout << "a: Increase acceleration | d: Decrease acceleration\n";
     std::cout << "e: Manual upshift | q: Manual downshift\n";
-    std::cout << "m: Toggle transmission mode\n";
-    std::cout << "Press Ctrl+C to stop.\n";
+    std::cout << "m: Toggle transmission mode | r: Rewind 1 second\n";
+    std::cout << "Press Ctrl+C to stop and print a summary.\n";
 
     const double target_frame_time = 1.0 / 60.0; // 60 FPS
+    // Slower redraws while nothing changes: at a fixed point, or when no key
+    // has been pressed for a while. Any key press restores the full rate.
+    const double quiescent_frame_time = 1.0;
+    const double unattended_frame_time = 0.25;
+    const double unattended_after = 30.0;
+
+    TerminalEvents events;
+    std::string error;
+    if (!events.open(error)) {
+        std::cout << "Cannot start the event loop: " << error << std::endl;
+        return;
+    }
+    double frame_interval = target_frame_time;
+    events.set_frame_interval(frame_interval);
+
     auto start_time = std::chrono::high_resolution_clock::now();
+    auto last_input_time = start_time;
     last_frame_time = start_time;
 
+    // The last minute of frames, for rewinding with 'r'
+    RewindBuffer history(60 * 60, 60);
+    EngineSnapshot rewound;
+    EngineSpec reloaded;
+    std::string reload_error;
+    std::string keys;
+    RunSummary summary;
+
     while (true) {
+        unsigned ready = events.wait(keys);
+        if (ready & TerminalEvents::QUIT) {
+            break;
+        }
         auto frame_start = std::chrono::high_resolution_clock::now();
+        if (ready & TerminalEvents::RESIZE) {
+            dashboard_drawn = false;
+        }
+        if (!keys.empty()) {
+            last_input_time = frame_start;
+        }
 
-        char input = get_user_input();
-        switch (input) {
-        case 'a':
-            acceleration += 10;
-            break;
-        case 'd':
-            acceleration -= 10;
-            break;
-        case 'e':
-            manual_upshift();
-            break;
-        case 'q':
-            manual_downshift();
-            break;
-        case 'm':
-            toggle_transmission_mode();
-            break;
+        for (char input : keys) {
+            switch (input) {
+            case 'a':
+                acceleration += 10;
+                break;
+            case 'd':
+                acceleration -= 10;
+                break;
+            case 'e':
+                manual_upshift();
+                break;
+            case 'q':
+                manual_downshift();
+                break;
+            case 'm':
+                toggle_transmission_mode();
+                break;
+            case 'r':
+                if (history.rewind_to_time(simulation_time - 1.0, rewound) && restore(rewound)) {
+                    gear_shift_message = "Rewound to t = " + std::to_string(static_cast<int>(simulation_time)) + " s";
+                    gear_shift_message_timer = 1.0;
+                }
+                break;
+            }
         }
 
-        double elapsed = std::chrono::duration<double>(frame_start - start_time).count();
+        if (config && config->take(reloaded)) {
+            if (apply_spec(reloaded)) {
+                gear_shift_message = "Reloaded engine spec " + reloaded.name;
+            }
+            else {
+                gear_shift_message = "Engine spec " + reloaded.name + " rejected";
+            }
+            gear_shift_message_timer = 2.0;
+        }
+        if (config && config->take_error(reload_error)) {
+            gear_shift_message = "Spec error: " + reload_error;
+            gear_shift_message_timer = 4.0;
+        }
+
+        double elapsed = std::min(MAX_FRAME_TIME, std::chrono::duration<double>(frame_start - start_time).count());
         update_dynamics(elapsed);
+        // Status events show in the message line instead of scrolling the dashboard
+        EngineEvent pending[16];
+        for (std::size_t n = drain_events(pending, 16); n > 0; n = drain_events(pending, 16)) {
+            gear_shift_message = describe_engine_event(pending[n - 1]);
+            gear_shift_message_timer = 2.0;
+        }
+        // A fixed point adds nothing worth rewinding to
+        if (!is_quiescent()) {
+            history.push(snapshot());
+        }
         simulate_performance();
+        std::cout.flush();
         current_fps = calculate_fps();
+        start_time = frame_start;
+        summary.add_frame(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - frame_start).count(),
+                          elapsed, sample_telemetry(simulation_time));
 
-        auto frame_end = std::chrono::high_resolution_clock::now();
-        double frame_duration = std::chrono::duration<double>(frame_end - frame_start).count();
-
-        if (frame_duration < target_frame_time) {
-            std::this_thread::sleep_for(std::chrono::duration<double>(target_frame_time - frame_duration));
+        double idle_time = std::chrono::duration<double>(frame_start - last_input_time).count();
+        double interval = target_frame_time;
+        if (is_quiescent() && gear_shift_message_timer <= 0) {
+            interval = quiescent_frame_time;
         }
+        else if (idle_time > unattended_after) {
+            interval = unattended_frame_time;
+        }
+        if (interval != frame_interval) {
+            frame_interval = interval;
+            events.set_frame_interval(frame_interval);
+        }
+    }
 
-        start_time = frame_start;
+    // Leave the terminal as it was found, below the dashboard
+    events.close();
+    std::cout << RESET << "\033[20;1H\n";
+    if (operating_point_cache) {
+        summary.set_cache_stats(operating_point_cache->hits(), operating_point_cache->misses());
     }
+    summary.print(std::cout);
+    std::cout.flush();
 }
\ No newline at end of file
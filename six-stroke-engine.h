@@ -3,27 +3,35 @@
 
 #include <string>
 #include <map>
-#include <functional>
 #include <vector>
 #include <queue>
 #include <numeric>
 #include <chrono>
+#include <cstdint>
+#include <optional>
+#include <atomic>
+
+#include "engine-model.h"
+#include "operating-point-cache.h"
+#include "telemetry.h"
+#include "engine-state.h"
+#include "cylinder-bank.h"
+#include "shift-map.h"
+#include "gearbox.h"
+#include "engine-spec.h"
+#include "engine-events.h"
+#include "spsc-queue.h"
 
 char get_user_input();
 
-class Gearbox {
-private:
-    std::vector<double> gear_ratios;
-    int current_gear;
+class ConfigWatcher;
 
-public:
-    Gearbox();
-    double get_current_ratio() const;
-    void shift_up();
-    void shift_down();
-    int get_current_gear() const;
-    //void manual_shift_up();
-    //void manual_shift_down();
+// Driveline and vehicle constants, for analyses that work in road speed
+struct VehicleParameters {
+    std::vector<double> rpm_per_speed;  // per gear, rpm per m/s of road speed
+    double vehicle_mass;
+    double idle_rpm;
+    double max_rpm;
 };
 
 class SixStrokeEngine {
@@ -51,8 +59,11 @@ private:
     std::queue<double> frame_times;
     std::chrono::high_resolution_clock::time_point last_frame_time;
     double current_fps;
+    // Cleared to repaint the whole dashboard, e.g. after a terminal resize
+    bool dashboard_drawn;
 
     // Dynamic simulation variables
+    double simulation_time;
     double acceleration;
     double jerk;
 
@@ -72,7 +83,54 @@ private:
 
     // Upgrade flags and effects
     std::map<std::string, bool> upgrades;
-    std::map<std::string, std::function<void()>> upgrade_effects;
+    std::map<std::string, UpgradeEffect<double>> upgrade_effects;
+    // The effects by position in `upgrades`, so update_upgrade_effect() needs
+    // no string lookups and restoring a snapshot never allocates
+    std::vector<UpgradeEffect<double>> effect_by_upgrade;
+    std::uint32_t cylinder_deactivation_bit;
+    UpgradeEffect<double> active_upgrade_effect;
+    // Calibration trim fitted against dyno data, applied on top of the upgrades
+    UpgradeEffect<double> calibration_trim;
+    std::uint32_t active_upgrade_mask;
+
+    // Optional memo of update_performance() results for long steady runs
+    std::optional<OperatingPointCache> operating_point_cache;
+    MathMode math_mode;
+
+    // Random jerk and water injection toggling; off for deterministic embedding
+    bool random_disturbances;
+    // xorshift64* state for the disturbances, saved in snapshots so a
+    // resumed run draws the same sequence
+    std::uint64_t random_state;
+    std::uint64_t next_random();
+
+    // Status changes (upgrades applied, water injection, transmission mode)
+    // for the UI or a logger to drain. The model never writes to the console
+    // or waits: when the ring is full, new events are counted and dropped.
+    SpscQueue<EngineEvent> events;
+    std::atomic<std::uint64_t> dropped_event_count;
+    void emit(EngineEventType type, std::int32_t value, const std::string& name = std::string());
+
+    // Everything a tick of update_dynamics() feeds back into the next one.
+    // Without disturbances, a tick that leaves it unchanged is a fixed point:
+    // later ticks only advance time and crank angle until something changes.
+    struct DynamicState {
+        double rpm;
+        double engine_temperature;
+        double volumetric_efficiency;
+        double acceleration;
+        double jerk;
+        int gear;
+        bool water_injection_active;
+        bool manual_transmission;
+        bool random_disturbances;
+        bool cylinders_deactivated;
+        double deactivation_dwell;
+    };
+    DynamicState dynamic_state() const;
+    static bool same_state(const DynamicState& a, const DynamicState& b);
+    bool quiescent;
+    DynamicState quiescent_state;
 
     // Six-stroke cycle specific
     bool water_injection_active;
@@ -82,26 +140,39 @@ private:
     double engine_temperature;
     double optimal_temperature;
 
+    // Spec the engine was built from or last reloaded from
+    EngineSpec engine_spec;
+
     // Gearbox and vehicle dynamics
     Gearbox gearbox;
     double vehicle_speed;
-    double wheel_radius;
-    double final_drive_ratio;
     double vehicle_mass;
+    ShiftMap shift_map;
+
+    // Per-cylinder phasing for crankshaft torque ripple and cylinder deactivation
+    CylinderBank cylinder_bank;
+    double crank_angle;
+    double instantaneous_torque;
+    bool cylinder_deactivation_enabled;
+    // Light-load state with hysteresis: the load must stay on the other side
+    // of its band for DEACTIVATION_DWELL seconds before the state flips
+    static constexpr double DEACTIVATION_DWELL = 1.0;
+    bool cylinders_deactivated;
+    double deactivation_dwell;   // seconds the load has wanted the other state
+    void update_cylinder_deactivation(double dt);
 
     // Helper functions
-    void calculate_displacement();
-    void calculate_rod_stroke_ratio();
-    void calculate_piston_speed();
-    double calculate_power() const;
-    double calculate_torque() const;
-    double calculate_thermal_efficiency() const;
+    void update_upgrade_effect();
     void update_performance();
     void update_vehicle_speed();
+    void shift_to(int gear);
+    void apply_shift_map();
+    static ShiftMap default_shift_map(const Gearbox& box);
 
 public:
     SixStrokeEngine();
-    void apply_upgrade(const std::string& upgrade);
+    explicit SixStrokeEngine(const EngineSpec& spec);
+    bool apply_upgrade(const std::string& upgrade);
     void toggle_water_injection(bool active);
     void simulate_performance();
     //void simulate_performance() const;
@@ -110,10 +181,62 @@ public:
     void toggle_transmission_mode();
     void manual_upshift();
     void manual_downshift();
-    void run_simulation();
+    // With a watcher, spec file changes are applied between frames. A frame
+    // simulates at most MAX_FRAME_TIME of wall-clock time, so a stall
+    // (suspend, debugger) is dropped rather than integrated in one step.
+    static constexpr double MAX_FRAME_TIME = 1.0;
+    void run_simulation(ConfigWatcher* config = nullptr);
     // New methods for dynamic simulation
     void update_dynamics(double dt);
+    // Runs `duration` seconds in steps of at most `max_step`, jumping to the
+    // end in one step once the engine is at a fixed point
+    void advance(double duration, double max_step);
+    bool is_quiescent() const;
     double calculate_fps();
+    // Inputs of the templated model, for analyses that re-evaluate it
+    EngineParameters<double> model_parameters() const;
+    const UpgradeEffect<double>& upgrade_effect() const;
+    OperatingPoint<double> operating_point() const;
+    VehicleParameters vehicle_parameters() const;
+    const UpgradeEffect<double>& calibration() const;
+    void set_calibration(double mean_effective_pressure, const UpgradeEffect<double>& trim);
+    void enable_performance_cache(const OperatingPointCacheConfig& config = OperatingPointCacheConfig());
+    void disable_performance_cache();
+    // Empties the cache and recomputes the current metrics exactly, so a
+    // recording and an engine resumed from its snapshot share cache state
+    void clear_performance_cache();
+    const OperatingPointCache* performance_cache() const;
+    void set_math_mode(MathMode mode);
+    TelemetryFrame sample_telemetry(double time) const;
+    EngineKeyState key_state() const;
+    void restore_key_state(const EngineKeyState& state);
+    double get_simulation_time() const;
+    void set_simulation_time(double time);
+    EngineSnapshot snapshot() const;
+    bool restore(const EngineSnapshot& snapshot);
+    // Quiet input setters for embedding the engine in another simulator
+    void set_random_disturbances(bool enabled);
+    void set_random_seed(std::uint64_t seed);
+    // Moves up to `max` pending events into `out` and returns the count. May be
+    // called from one other thread while the engine runs.
+    std::size_t drain_events(EngineEvent* out, std::size_t max);
+    std::uint64_t dropped_events() const;
+    void set_acceleration(double value);
+    void set_water_injection(bool active);
+    void set_manual_transmission(bool manual);
+    const CylinderBank& cylinders() const;
+    // Switches to a new spec in place, keeping the running state. Only the
+    // tables that depend on changed values are rebuilt.
+    bool apply_spec(const EngineSpec& spec);
+    const EngineSpec& loaded_spec() const;
+    // Swaps the driveline and rebuilds the default shift schedule for it
+    bool set_gearbox(const GearboxSpec& spec);
+    const Gearbox& get_gearbox() const;
+    // Replaces the automatic shift schedule; the gear count must match the gearbox
+    bool set_shift_map(const ShiftMap& map);
+    const ShiftMap& get_shift_map() const;
+    double get_crank_angle() const;
+    double get_instantaneous_torque() const;
 };
 
 #endif // SIX_STROKE_ENGINE_H
\ No newline at end of file
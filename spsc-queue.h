@@ -0,0 +1,74 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. The indices only grow and are masked into a power-of-two ring;
+// each side caches the other's index so most operations touch one shared
+// cache line.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(std::size_t capacity) :
+        slots(round_up(capacity)),
+        mask(slots.size() - 1),
+        write_index(0),
+        cached_read_index(0),
+        read_index(0),
+        cached_write_index(0)
+    {
+    }
+
+    // Producer side; false when the queue is full
+    bool push(const T& item) {
+        std::size_t write = write_index.load(std::memory_order_relaxed);
+        if (write - cached_read_index == slots.size()) {
+            cached_read_index = read_index.load(std::memory_order_acquire);
+            if (write - cached_read_index == slots.size()) {
+                return false;
+            }
+        }
+        slots[write & mask] = item;
+        write_index.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side; moves up to `max` items into `out` and returns the count
+    std::size_t pop(T* out, std::size_t max) {
+        std::size_t read = read_index.load(std::memory_order_relaxed);
+        if (cached_write_index == read) {
+            cached_write_index = write_index.load(std::memory_order_acquire);
+        }
+        std::size_t count = std::min(max, cached_write_index - read);
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i] = slots[(read + i) & mask];
+        }
+        read_index.store(read + count, std::memory_order_release);
+        return count;
+    }
+
+    std::size_t capacity() const {
+        return slots.size();
+    }
+
+private:
+    static std::size_t round_up(std::size_t n) {
+        std::size_t size = 1;
+        while (size < n) size <<= 1;
+        return size;
+    }
+
+    std::vector<T> slots;
+    std::size_t mask;
+
+    alignas(64) std::atomic<std::size_t> write_index;
+    std::size_t cached_read_index;    // producer's copy
+    alignas(64) std::atomic<std::size_t> read_index;
+    std::size_t cached_write_index;   // consumer's copy
+};
+
+#endif // SPSC_QUEUE_H
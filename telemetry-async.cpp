@@ -0,0 +1,569 @@
+#include "telemetry-async.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define TELEMETRY_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+constexpr std::size_t PAGE_SIZE = 4096;
+// Frames the writer thread takes off the queue at a time
+constexpr std::size_t POP_BATCH = 4096;
+
+#ifdef TELEMETRY_IO_URING
+// Just enough io_uring for vectored file writes, through raw syscalls so no
+// liburing is needed. One submission per write, completions reaped in order
+// of arrival.
+class Uring {
+public:
+    ~Uring() {
+        if (sqes) munmap(sqes, sqes_size);
+        if (cq_ring && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+        if (sq_ring) munmap(sq_ring, sq_ring_size);
+        if (ring_fd >= 0) close(ring_fd);
+    }
+
+    // False when the kernel lacks io_uring or a sandbox forbids it
+    bool init(unsigned entries) {
+        io_uring_params params{};
+        ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_fd < 0) {
+            return false;
+        }
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+        }
+        sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+        cq_ring = single_mmap ? sq_ring
+            : mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqe_memory = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+        if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqe_memory == MAP_FAILED) {
+            sq_ring = sq_ring == MAP_FAILED ? nullptr : sq_ring;
+            cq_ring = cq_ring == MAP_FAILED ? nullptr : cq_ring;
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe*>(sqe_memory);
+
+        char* sq = static_cast<char*>(sq_ring);
+        char* cq = static_cast<char*>(cq_ring);
+        sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_entries = params.sq_entries;
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    bool submit_writev(int fd, const iovec* iov, std::uint64_t offset, std::uint64_t user_data) {
+        unsigned tail = *sq_tail;
+        if (tail - std::atomic_ref<unsigned>(*sq_head).load(std::memory_order_acquire) >= sq_entries) {
+            return false;
+        }
+        unsigned index = tail & sq_mask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITEV;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(iov);
+        sqe.len = 1;
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        sq_array[index] = index;
+        std::atomic_ref<unsigned>(*sq_tail).store(tail + 1, std::memory_order_release);
+        return enter(1, 0, 0) >= 0;
+    }
+
+    // Blocks until one write completes
+    bool wait(std::int32_t& result, std::uint64_t& user_data) {
+        while (true) {
+            unsigned head = *cq_head;
+            if (head != std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire)) {
+                const io_uring_cqe& cqe = cqes[head & cq_mask];
+                result = cqe.res;
+                user_data = cqe.user_data;
+                std::atomic_ref<unsigned>(*cq_head).store(head + 1, std::memory_order_release);
+                return true;
+            }
+            if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+private:
+    long enter(unsigned submit, unsigned min_complete, unsigned flags) {
+        return syscall(__NR_io_uring_enter, ring_fd, submit, min_complete, flags, nullptr, 0);
+    }
+
+    int ring_fd = -1;
+    void* sq_ring = nullptr;
+    void* cq_ring = nullptr;
+    std::size_t sq_ring_size = 0;
+    std::size_t cq_ring_size = 0;
+    std::size_t sqes_size = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_mask = 0;
+    unsigned sq_entries = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+};
+#endif
+
+} // namespace
+
+// Page-aligned staging buffers and the platform write path. Only the writer
+// thread calls into it; the counters are read by stats().
+class AsyncTelemetryWriter::Output {
+public:
+    Output(const AsyncTelemetryConfig& config) :
+        frames_written(0),
+        bytes_written(0),
+        writes(0),
+        io_uring(false),
+        buffer_bytes((std::max<std::size_t>(config.buffer_bytes, PAGE_SIZE) + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE),
+        buffers(static_cast<std::size_t>(std::max(config.buffer_count, 2))),
+        current(0),
+        failed(false),
+        use_io_uring(config.use_io_uring)
+    {
+        for (Buffer& buffer : buffers) {
+            buffer.data = static_cast<std::uint8_t*>(aligned_allocate(buffer_bytes));
+        }
+    }
+
+    ~Output() {
+        std::string error;
+        finish(error);
+        // A buffer still busy here was in flight when io_uring stopped
+        // answering; the kernel may still read it, so it is not freed
+        for (Buffer& buffer : buffers) {
+            if (!buffer.busy) {
+                aligned_free(buffer.data);
+            }
+        }
+    }
+
+    bool open(const std::string& path, std::string& error) {
+#ifdef _WIN32
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            error = "cannot open " + path;
+            return false;
+        }
+#else
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            error = "cannot open " + path;
+            return false;
+        }
+#ifdef TELEMETRY_IO_URING
+        io_uring = use_io_uring && ring.init(static_cast<unsigned>(buffers.size()));
+#endif
+#endif
+        return true;
+    }
+
+    // `frames` are counted as written once the buffer holding the last of
+    // their bytes has been written
+    void append(const std::uint8_t* data, std::size_t size, std::uint64_t frames) {
+        while (size > 0 && !failed) {
+            Buffer& buffer = buffers[current];
+            std::size_t count = std::min(size, buffer_bytes - buffer.used);
+            std::memcpy(buffer.data + buffer.used, data, count);
+            buffer.used += count;
+            data += count;
+            size -= count;
+            if (size == 0) {
+                buffer.frames += frames;
+            }
+            if (buffer.used == buffer_bytes) {
+                submit_current();
+            }
+        }
+    }
+
+    // Writes the partial last buffer, waits for all writes and closes the file
+    bool finish(std::string& error) {
+        if (is_open()) {
+            if (buffers[current].used > 0 && !failed) {
+                submit_current();
+            }
+            complete_all();
+#ifdef _WIN32
+            out.close();
+#else
+            ::close(fd);
+            fd = -1;
+#endif
+        }
+        error = message;
+        return !failed;
+    }
+
+    std::atomic<std::uint64_t> frames_written;
+    std::atomic<std::uint64_t> bytes_written;
+    std::atomic<std::uint64_t> writes;
+    std::atomic<bool> io_uring;
+
+private:
+    struct Buffer {
+        std::uint8_t* data = nullptr;
+        std::size_t used = 0;
+        std::uint64_t frames = 0;
+        std::uint64_t offset = 0;
+        bool busy = false;
+#ifndef _WIN32
+        iovec io{};
+#endif
+    };
+
+    static void* aligned_allocate(std::size_t size) {
+#ifdef _WIN32
+        return _aligned_malloc(size, PAGE_SIZE);
+#else
+        return std::aligned_alloc(PAGE_SIZE, size);
+#endif
+    }
+
+    static void aligned_free(void* p) {
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+
+    bool is_open() const {
+#ifdef _WIN32
+        return out.is_open();
+#else
+        return fd >= 0;
+#endif
+    }
+
+    void fail(const std::string& what) {
+        if (!failed) {
+            failed = true;
+            message = what;
+        }
+    }
+
+    // Hands the current buffer to the kernel and moves on to a free one
+    void submit_current() {
+        Buffer& buffer = buffers[current];
+        buffer.offset = file_offset;
+        buffer.busy = true;
+        file_offset += buffer.used;
+#ifndef _WIN32
+        buffer.io = { buffer.data, buffer.used };
+#endif
+        bool queued = false;
+#ifdef TELEMETRY_IO_URING
+        if (io_uring) {
+            queued = true;
+            if (ring.submit_writev(fd, &buffer.io, buffer.offset, current)) {
+                ++in_flight;
+                pending.push_back(current);
+            }
+            else {
+                fail("io_uring submission failed");
+                release(current, false);
+            }
+        }
+#endif
+        if (!queued) {
+            // Written together with the others once every buffer is full
+            pending.push_back(current);
+        }
+
+        auto free_buffer = [&]() {
+            return std::find_if(buffers.begin(), buffers.end(), [](const Buffer& b) { return !b.busy; });
+        };
+        auto next = free_buffer();
+        if (next == buffers.end()) {
+            complete_one();
+            next = free_buffer();
+        }
+        // None free only once writing has failed, and then nothing more is appended
+        if (next != buffers.end()) {
+            current = static_cast<std::size_t>(next - buffers.begin());
+        }
+    }
+
+    void release(std::size_t index, bool written) {
+        Buffer& buffer = buffers[index];
+        if (written) {
+            bytes_written.fetch_add(buffer.used, std::memory_order_relaxed);
+            frames_written.fetch_add(buffer.frames, std::memory_order_relaxed);
+        }
+        buffer.used = 0;
+        buffer.frames = 0;
+        buffer.busy = false;
+    }
+
+    // Frees at least one busy buffer, unless io_uring fails
+    void complete_one() {
+#ifdef TELEMETRY_IO_URING
+        if (io_uring) {
+            std::int32_t result;
+            std::uint64_t index;
+            if (!ring.wait(result, index)) {
+                abandon_ring("io_uring wait failed");
+                return;
+            }
+            auto done = std::find(pending.begin(), pending.end(), index);
+            if (done == pending.end()) {
+                abandon_ring("io_uring completed an unknown write");
+                return;
+            }
+            --in_flight;
+            pending.erase(done);
+            Buffer& buffer = buffers[index];
+            bool written = result >= 0 && !failed;
+            if (result < 0) {
+                fail(std::string("write failed: ") + std::strerror(-result));
+            }
+            else if (static_cast<std::size_t>(result) < buffer.used && !failed) {
+                // Short write: finish the rest synchronously
+                write_all(buffer.data + result, buffer.used - result, buffer.offset + result);
+                written = !failed;
+            }
+            writes.fetch_add(1, std::memory_order_relaxed);
+            release(index, written);
+            return;
+        }
+#endif
+        write_pending();
+    }
+
+#ifdef TELEMETRY_IO_URING
+    // The writes still in flight can no longer be reaped, so their buffers
+    // stay busy for good and the file is failed
+    void abandon_ring(const std::string& what) {
+        fail(what);
+        pending.clear();
+        in_flight = 0;
+    }
+#endif
+
+    void complete_all() {
+#ifdef TELEMETRY_IO_URING
+        while (io_uring && in_flight > 0) {
+            complete_one();
+        }
+#endif
+        if (!pending.empty()) {
+            write_pending();
+        }
+    }
+
+    // Fallback path: all full buffers in one gathered write
+    void write_pending() {
+#ifdef _WIN32
+        for (std::size_t index : pending) {
+            out.write(reinterpret_cast<const char*>(buffers[index].data), buffers[index].used);
+            writes.fetch_add(1, std::memory_order_relaxed);
+            if (!out) {
+                fail("write failed");
+            }
+            release(index, !failed);
+        }
+#else
+        std::vector<iovec> io;
+        for (std::size_t index : pending) {
+            io.push_back(buffers[index].io);
+        }
+        std::size_t first = 0;
+        while (first < io.size() && !failed) {
+            ssize_t written = writev(fd, io.data() + first, static_cast<int>(std::min<std::size_t>(io.size() - first, IOV_MAX)));
+            writes.fetch_add(1, std::memory_order_relaxed);
+            if (written < 0) {
+                if (errno != EINTR) {
+                    fail(std::string("write failed: ") + std::strerror(errno));
+                }
+                continue;
+            }
+            // Skip what was written, possibly stopping inside one buffer
+            std::size_t remaining = static_cast<std::size_t>(written);
+            while (first < io.size() && remaining >= io[first].iov_len) {
+                remaining -= io[first++].iov_len;
+            }
+            if (first < io.size()) {
+                io[first].iov_base = static_cast<std::uint8_t*>(io[first].iov_base) + remaining;
+                io[first].iov_len -= remaining;
+            }
+        }
+        // Buffers before `first` were written in full
+        for (std::size_t i = 0; i < pending.size(); ++i) {
+            release(pending[i], i < first);
+        }
+#endif
+        pending.clear();
+    }
+
+#ifndef _WIN32
+    void write_all(const std::uint8_t* data, std::size_t size, std::uint64_t offset) {
+        while (size > 0) {
+            ssize_t written = pwrite(fd, data, size, static_cast<off_t>(offset));
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                fail(std::string("write failed: ") + std::strerror(errno));
+                return;
+            }
+            data += written;
+            size -= static_cast<std::size_t>(written);
+            offset += static_cast<std::uint64_t>(written);
+        }
+    }
+#endif
+
+    std::size_t buffer_bytes;
+    std::vector<Buffer> buffers;
+    std::size_t current;
+    std::vector<std::size_t> pending;    // submitted, not yet completed, oldest first
+    std::uint64_t file_offset = 0;
+    bool failed;
+    std::string message;
+    bool use_io_uring;
+#ifdef _WIN32
+    std::ofstream out;
+#else
+    int fd = -1;
+#endif
+#ifdef TELEMETRY_IO_URING
+    Uring ring;
+    int in_flight = 0;
+#endif
+};
+
+AsyncTelemetryWriter::AsyncTelemetryWriter(const AsyncTelemetryConfig& config) :
+    config(config),
+    queue(config.queue_frames),
+    running(false),
+    frames_queued(0),
+    frames_dropped(0),
+    blocked_pushes(0)
+{
+}
+
+AsyncTelemetryWriter::~AsyncTelemetryWriter() {
+    std::string error;
+    close(error);
+}
+
+bool AsyncTelemetryWriter::open(const std::string& path, std::string& error) {
+    if (running) {
+        error = "already open";
+        return false;
+    }
+    output = std::make_unique<Output>(config);
+    if (!output->open(path, error)) {
+        output.reset();
+        return false;
+    }
+    running = true;
+    worker = std::thread(&AsyncTelemetryWriter::run, this);
+    return true;
+}
+
+bool AsyncTelemetryWriter::push(const TelemetryFrame& frame) {
+    if (!queue.push(frame)) {
+        if (config.policy == BackpressurePolicy::Drop) {
+            frames_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        blocked_pushes.fetch_add(1, std::memory_order_relaxed);
+        while (!queue.push(frame)) {
+            std::this_thread::yield();
+        }
+    }
+    frames_queued.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool AsyncTelemetryWriter::close(std::string& error) {
+    if (!output) {
+        return true;
+    }
+    running = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    return output->finish(error);
+}
+
+AsyncTelemetryStats AsyncTelemetryWriter::stats() const {
+    AsyncTelemetryStats s{};
+    s.frames_queued = frames_queued.load(std::memory_order_relaxed);
+    s.frames_dropped = frames_dropped.load(std::memory_order_relaxed);
+    s.blocked_pushes = blocked_pushes.load(std::memory_order_relaxed);
+    if (output) {
+        s.frames_written = output->frames_written.load(std::memory_order_relaxed);
+        s.bytes_written = output->bytes_written.load(std::memory_order_relaxed);
+        s.writes = output->writes.load(std::memory_order_relaxed);
+        s.io_uring = output->io_uring.load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+void AsyncTelemetryWriter::run() {
+    TelemetryEncoder encoder(config.codec);
+    std::vector<TelemetryFrame> batch(POP_BATCH);
+    std::vector<std::uint8_t> bytes;
+    // Frames appended to the encoder whose bytes have not been handed on yet
+    std::uint64_t encoded = 0;
+    auto write_encoded = [&]() {
+        encoder.drain(bytes);
+        output->append(bytes.data(), bytes.size(), encoded);
+        encoded = 0;
+    };
+
+    while (true) {
+        // Checked before popping, so frames pushed before close() are still written
+        bool stopping = !running.load(std::memory_order_acquire);
+        std::size_t count = queue.pop(batch.data(), batch.size());
+        for (std::size_t i = 0; i < count; ++i) {
+            ++encoded;
+            if (encoder.append(batch[i])) {
+                write_encoded();
+            }
+        }
+        if (count == 0) {
+            if (stopping) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    encoder.finish();
+    write_encoded();
+}
@@ -0,0 +1,77 @@
+#ifndef TELEMETRY_ASYNC_H
+#define TELEMETRY_ASYNC_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc-queue.h"
+#include "telemetry-codec.h"
+
+enum class BackpressurePolicy {
+    Drop,   // a full queue discards the frame and counts it
+    Block   // a full queue makes the simulation thread wait for space
+};
+
+struct AsyncTelemetryConfig {
+    std::size_t queue_frames = 65536;
+    std::size_t buffer_bytes = 1 << 20;   // rounded up to whole 4 KiB pages
+    int buffer_count = 4;                 // writes in flight, plus one being filled
+    BackpressurePolicy policy = BackpressurePolicy::Drop;
+    bool use_io_uring = true;
+    TelemetryCodecConfig codec;
+};
+
+struct AsyncTelemetryStats {
+    std::uint64_t frames_queued;
+    std::uint64_t frames_dropped;
+    std::uint64_t blocked_pushes;
+    std::uint64_t frames_written;   // frames whose encoded bytes reached the file
+    std::uint64_t bytes_written;
+    std::uint64_t writes;
+    bool io_uring;
+};
+
+// Delta-encoded telemetry stream (the TelemetryEncoder format) written from
+// a background thread. The simulation thread only copies frames into a
+// lock-free queue. The writer thread encodes them into page-aligned buffers
+// and writes each full buffer with io_uring on Linux when the kernel allows
+// it, else by gathering the full buffers into one writev() call. Disk
+// stalls therefore only fill the queue, and the backpressure policy decides
+// what happens when it is full.
+class AsyncTelemetryWriter {
+public:
+    explicit AsyncTelemetryWriter(const AsyncTelemetryConfig& config = AsyncTelemetryConfig());
+    ~AsyncTelemetryWriter();
+    AsyncTelemetryWriter(const AsyncTelemetryWriter&) = delete;
+    AsyncTelemetryWriter& operator=(const AsyncTelemetryWriter&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    // Simulation thread only. False when the frame was dropped.
+    bool push(const TelemetryFrame& frame);
+    // Writes everything still queued and closes the file
+    bool close(std::string& error);
+
+    AsyncTelemetryStats stats() const;
+
+private:
+    class Output;
+
+    void run();
+
+    AsyncTelemetryConfig config;
+    SpscQueue<TelemetryFrame> queue;
+    std::unique_ptr<Output> output;
+    std::thread worker;
+    std::atomic<bool> running;
+
+    std::atomic<std::uint64_t> frames_queued;
+    std::atomic<std::uint64_t> frames_dropped;
+    std::atomic<std::uint64_t> blocked_pushes;
+};
+
+#endif // TELEMETRY_ASYNC_H
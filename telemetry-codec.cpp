@@ -0,0 +1,344 @@
+#include "telemetry-codec.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const char STREAM_MAGIC[4] = { 'S', 'S', 'T', 'Z' };
+const std::uint32_t STREAM_VERSION = 1;
+const std::uint32_t BLOCK_MAGIC = 0x314b4c42; // "BLK1"
+const std::uint32_t MAX_BLOCK_FRAMES = 1u << 20;
+
+struct StreamHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t channel_count;
+    std::uint32_t block_frames;
+    double resolution[TelemetryChannelCount];
+};
+
+bool is_run_length(int channel) {
+    return channel == ChannelGear || channel == ChannelWaterInjection || channel == ChannelManualTransmission;
+}
+
+std::uint64_t zigzag(std::int64_t v) {
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+std::int64_t unzigzag(std::uint64_t v) {
+    return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+}
+
+// Two's-complement addition, so corrupt deltas wrap instead of overflowing
+std::int64_t wrapping_add(std::int64_t a, std::int64_t b) {
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) + static_cast<std::uint64_t>(b));
+}
+
+void put_varint(std::vector<std::uint8_t>& out, std::uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(v));
+}
+
+bool get_varint(const std::uint8_t*& p, const std::uint8_t* end, std::uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        std::uint8_t byte = *p++;
+        v |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<std::uint8_t>& out) : out(out), accumulator(0), bits(0) {}
+
+    void put(std::uint64_t value, unsigned width) {
+        for (unsigned written = 0; written < width;) {
+            unsigned take = std::min(width - written, 64 - bits);
+            std::uint64_t part = (value >> written) & (take == 64 ? ~0ull : ((1ull << take) - 1));
+            accumulator |= part << bits;
+            bits += take;
+            written += take;
+            if (bits == 64) {
+                spill(8);
+            }
+        }
+    }
+
+    void finish() {
+        spill((bits + 7) / 8);
+    }
+
+private:
+    void spill(unsigned bytes) {
+        for (unsigned i = 0; i < bytes; ++i) {
+            out.push_back(static_cast<std::uint8_t>(accumulator >> (8 * i)));
+        }
+        accumulator = 0;
+        bits = 0;
+    }
+
+    std::vector<std::uint8_t>& out;
+    std::uint64_t accumulator;
+    unsigned bits;
+};
+
+class BitReader {
+public:
+    BitReader(const std::uint8_t* p, const std::uint8_t* end) : p(p), end(end), bit(0) {}
+
+    std::uint64_t get(unsigned width) {
+        std::uint64_t value = 0;
+        for (unsigned got = 0; got < width;) {
+            std::size_t byte = bit >> 3;
+            unsigned offset = bit & 7;
+            unsigned take = std::min(width - got, 8 - offset);
+            std::uint64_t b = p + byte < end ? p[byte] : 0;
+            value |= ((b >> offset) & ((1ull << take) - 1)) << got;
+            got += take;
+            bit += take;
+        }
+        return value;
+    }
+
+    const std::uint8_t* position() const {
+        return p + (bit + 7) / 8;
+    }
+
+    // True when reads ran past the end and returned padding
+    bool overrun() const {
+        return (bit + 7) / 8 > static_cast<std::size_t>(end - p);
+    }
+
+private:
+    const std::uint8_t* p;
+    const std::uint8_t* end;
+    std::size_t bit;
+};
+
+} // namespace
+
+TelemetryEncoder::TelemetryEncoder(const TelemetryCodecConfig& config) :
+    config(config),
+    block_first_time(0),
+    frame_count(0),
+    byte_count(0)
+{
+    for (auto& channel : quantized) {
+        channel.reserve(config.block_frames);
+    }
+
+    StreamHeader header{};
+    std::memcpy(header.magic, STREAM_MAGIC, sizeof(STREAM_MAGIC));
+    header.version = STREAM_VERSION;
+    header.channel_count = TelemetryChannelCount;
+    header.block_frames = config.block_frames;
+    std::memcpy(header.resolution, config.resolution, sizeof(header.resolution));
+    const auto* bytes = reinterpret_cast<const std::uint8_t*>(&header);
+    output.insert(output.end(), bytes, bytes + sizeof(header));
+    byte_count = sizeof(header);
+}
+
+bool TelemetryEncoder::append(const TelemetryFrame& frame) {
+    if (quantized[0].empty()) {
+        block_first_time = frame.time;
+    }
+    for (int c = 0; c < TelemetryChannelCount; ++c) {
+        quantized[c].push_back(std::llround(telemetry_channel_value(frame, c) / config.resolution[c]));
+    }
+    ++frame_count;
+    if (quantized[0].size() >= config.block_frames) {
+        encode_block();
+        return true;
+    }
+    return false;
+}
+
+void TelemetryEncoder::finish() {
+    if (!quantized[0].empty()) {
+        encode_block();
+    }
+}
+
+void TelemetryEncoder::drain(std::vector<std::uint8_t>& out) {
+    out.swap(output);
+    output.clear();
+}
+
+bool TelemetryEncoder::at_block_start() const {
+    return quantized[0].empty();
+}
+
+std::uint64_t TelemetryEncoder::next_block_offset() const {
+    return byte_count;
+}
+
+std::uint64_t TelemetryEncoder::frames_encoded() const {
+    return frame_count;
+}
+
+std::uint64_t TelemetryEncoder::bytes_encoded() const {
+    return byte_count;
+}
+
+void TelemetryEncoder::encode_block() {
+    const std::size_t n = quantized[0].size();
+    const std::size_t header_at = output.size();
+    output.resize(header_at + sizeof(TelemetryBlockHeader));
+
+    std::vector<std::uint64_t> residuals(n);
+    for (int c = 0; c < TelemetryChannelCount; ++c) {
+        const std::vector<std::int64_t>& q = quantized[c];
+        if (is_run_length(c)) {
+            std::size_t runs = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                runs += (i == 0 || q[i] != q[i - 1]) ? 1 : 0;
+            }
+            put_varint(output, runs);
+            for (std::size_t i = 0; i < n;) {
+                std::size_t j = i;
+                while (j < n && q[j] == q[i]) ++j;
+                put_varint(output, zigzag(q[i]));
+                put_varint(output, j - i);
+                i = j;
+            }
+            continue;
+        }
+
+        // First value and first delta as varints, then delta-of-delta bit-packed
+        put_varint(output, zigzag(q[0]));
+        if (n < 2) {
+            continue;
+        }
+        put_varint(output, zigzag(q[1] - q[0]));
+        std::uint64_t widest = 0;
+        for (std::size_t i = 2; i < n; ++i) {
+            residuals[i] = zigzag((q[i] - q[i - 1]) - (q[i - 1] - q[i - 2]));
+            widest |= residuals[i];
+        }
+        unsigned width = widest ? 64 - std::countl_zero(widest) : 0;
+        output.push_back(static_cast<std::uint8_t>(width));
+        BitWriter bits(output);
+        for (std::size_t i = 2; i < n && width > 0; ++i) {
+            bits.put(residuals[i], width);
+        }
+        bits.finish();
+    }
+
+    TelemetryBlockHeader header{};
+    header.magic = BLOCK_MAGIC;
+    header.frame_count = static_cast<std::uint32_t>(n);
+    header.first_time = block_first_time;
+    header.payload_bytes = static_cast<std::uint32_t>(output.size() - header_at - sizeof(header));
+    std::memcpy(output.data() + header_at, &header, sizeof(header));
+    byte_count += output.size() - header_at;
+
+    for (auto& channel : quantized) {
+        channel.clear();
+    }
+}
+
+bool TelemetryDecoder::open(std::istream& stream) {
+    in = &stream;
+    StreamHeader header{};
+    if (!in->read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, STREAM_MAGIC, sizeof(STREAM_MAGIC)) != 0 ||
+        header.version != STREAM_VERSION || header.channel_count != TelemetryChannelCount ||
+        header.block_frames == 0 || header.block_frames > MAX_BLOCK_FRAMES) {
+        return false;
+    }
+    config.block_frames = header.block_frames;
+    std::memcpy(config.resolution, header.resolution, sizeof(header.resolution));
+    frames.clear();
+    position = 0;
+    return true;
+}
+
+bool TelemetryDecoder::seek_block(std::streamoff offset) {
+    in->clear();
+    in->seekg(offset);
+    frames.clear();
+    position = 0;
+    return static_cast<bool>(*in);
+}
+
+const TelemetryCodecConfig& TelemetryDecoder::codec_config() const {
+    return config;
+}
+
+bool TelemetryDecoder::next(TelemetryFrame& frame) {
+    if (position == frames.size() && !read_block()) {
+        return false;
+    }
+    frame = frames[position++];
+    return true;
+}
+
+bool TelemetryDecoder::read_block() {
+    TelemetryBlockHeader header;
+    if (!in || !in->read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != BLOCK_MAGIC ||
+        header.frame_count == 0 || header.frame_count > config.block_frames ||
+        header.payload_bytes > std::uint64_t(header.frame_count) * TelemetryChannelCount * 20) {
+        return false;
+    }
+    payload.resize(header.payload_bytes);
+    if (!in->read(reinterpret_cast<char*>(payload.data()), payload.size())) {
+        return false;
+    }
+
+    const std::size_t n = header.frame_count;
+    frames.assign(n, TelemetryFrame{});
+    position = 0;
+    const std::uint8_t* p = payload.data();
+    const std::uint8_t* end = p + payload.size();
+    std::uint64_t v;
+
+    for (int c = 0; c < TelemetryChannelCount; ++c) {
+        const double resolution = config.resolution[c];
+        if (is_run_length(c)) {
+            std::uint64_t runs;
+            if (!get_varint(p, end, runs)) return false;
+            std::size_t i = 0;
+            for (std::uint64_t r = 0; r < runs; ++r) {
+                std::uint64_t value, length;
+                if (!get_varint(p, end, value) || !get_varint(p, end, length) || length > n - i) return false;
+                for (std::uint64_t k = 0; k < length; ++k, ++i) {
+                    set_telemetry_channel_value(frames[i], c, unzigzag(value) * resolution);
+                }
+            }
+            if (i != n) return false;
+            continue;
+        }
+
+        if (!get_varint(p, end, v)) return false;
+        std::int64_t q = unzigzag(v);
+        set_telemetry_channel_value(frames[0], c, q * resolution);
+        if (n < 2) {
+            continue;
+        }
+        if (!get_varint(p, end, v) || p >= end) return false;
+        std::int64_t delta = unzigzag(v);
+        unsigned width = *p++;
+        if (width > 64) return false;
+        q = wrapping_add(q, delta);
+        set_telemetry_channel_value(frames[1], c, q * resolution);
+
+        BitReader bits(p, end);
+        for (std::size_t i = 2; i < n; ++i) {
+            delta = wrapping_add(delta, width > 0 ? unzigzag(bits.get(width)) : 0);
+            q = wrapping_add(q, delta);
+            set_telemetry_channel_value(frames[i], c, q * resolution);
+        }
+        if (bits.overrun()) return false;
+        p = bits.position();
+    }
+    return true;
+}
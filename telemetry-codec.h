@@ -0,0 +1,94 @@
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <cstdint>
+#include <istream>
+#include <vector>
+
+#include "telemetry.h"
+
+// Compressed telemetry stream for fleet logging. Every channel is quantized
+// to a fixed resolution and encoded per block of frames: continuous channels
+// as delta-of-delta values bit-packed at the block's widest width, gear and
+// flags as run-length pairs. Blocks are self-contained, so a reader can
+// start decoding at any block boundary.
+struct TelemetryCodecConfig {
+    double resolution[TelemetryChannelCount] = {
+        1e-4,  // time, s
+        0.1,   // rpm
+        0.01,  // torque, Nm
+        0.001, // power, kW
+        0.001, // engine_temperature, C
+        1,     // gear
+        1e-5,  // nox
+        0.01,  // bsfc
+        0.001, // vehicle_speed, m/s
+        1e-4,  // fuel_consumption, kg/h
+        1e-5,  // thermal_efficiency
+        0.001, // acceleration
+        0.001, // jerk
+        1,     // water_injection
+        1      // manual_transmission
+    };
+    std::uint32_t block_frames = 1024;
+};
+
+struct TelemetryBlockHeader {
+    std::uint32_t magic;
+    std::uint32_t frame_count;
+    double first_time;
+    std::uint32_t payload_bytes;
+    std::uint32_t reserved;
+};
+
+class TelemetryEncoder {
+public:
+    explicit TelemetryEncoder(const TelemetryCodecConfig& config = TelemetryCodecConfig());
+
+    // Returns true when the frame completed a block and new bytes are ready
+    bool append(const TelemetryFrame& frame);
+    // Encodes any partially filled block
+    void finish();
+    // Moves the encoded bytes (stream header first) into `out`, replacing its contents
+    void drain(std::vector<std::uint8_t>& out);
+
+    // True when the next append() starts a new block, which will begin at
+    // next_block_offset() bytes into the stream
+    bool at_block_start() const;
+    std::uint64_t next_block_offset() const;
+
+    std::uint64_t frames_encoded() const;
+    std::uint64_t bytes_encoded() const;
+
+private:
+    void encode_block();
+
+    TelemetryCodecConfig config;
+    std::vector<std::int64_t> quantized[TelemetryChannelCount];
+    double block_first_time;
+    std::vector<std::uint8_t> output;
+    std::uint64_t frame_count;
+    std::uint64_t byte_count;
+};
+
+class TelemetryDecoder {
+public:
+    // Reads the stream header; false if `in` is not a compressed telemetry stream
+    bool open(std::istream& in);
+    bool next(TelemetryFrame& frame);
+    // Positions the decoder at a block boundary previously reported by the encoder
+    bool seek_block(std::streamoff offset);
+
+    const TelemetryCodecConfig& codec_config() const;
+
+private:
+    bool read_block();
+
+    std::istream* in = nullptr;
+    TelemetryCodecConfig config;
+    std::vector<TelemetryFrame> frames;
+    std::size_t position = 0;
+    std::vector<std::uint8_t> payload;
+};
+
+#endif // TELEMETRY_CODEC_H
@@ -0,0 +1,344 @@
+#include "telemetry-columnar.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <sstream>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const char FILE_MAGIC[4] = { 'S', 'S', 'T', 'C' };
+const std::uint32_t FILE_VERSION = 1;
+const std::uint32_t CHUNK_MAGIC = 0x4b4e4843; // "CHNK"
+
+struct FileHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t channel_count;
+    std::uint32_t reserved;
+};
+
+struct ChunkHeader {
+    std::uint32_t magic;
+    std::uint32_t rows;
+    double min[TelemetryChannelCount];
+    double max[TelemetryChannelCount];
+};
+
+bool range_may_match(const TelemetryPredicate& p, double lo, double hi) {
+    switch (p.op) {
+    case TelemetryPredicate::Less: return lo < p.value;
+    case TelemetryPredicate::LessEqual: return lo <= p.value;
+    case TelemetryPredicate::Greater: return hi > p.value;
+    case TelemetryPredicate::GreaterEqual: return hi >= p.value;
+    case TelemetryPredicate::Equal: return lo <= p.value && p.value <= hi;
+    case TelemetryPredicate::NotEqual: return !(lo == p.value && hi == p.value);
+    }
+    return true;
+}
+
+template <TelemetryPredicate::Op Op>
+bool compare(double x, double v) {
+    if constexpr (Op == TelemetryPredicate::Less) return x < v;
+    else if constexpr (Op == TelemetryPredicate::LessEqual) return x <= v;
+    else if constexpr (Op == TelemetryPredicate::Greater) return x > v;
+    else if constexpr (Op == TelemetryPredicate::GreaterEqual) return x >= v;
+    else if constexpr (Op == TelemetryPredicate::Equal) return x == v;
+    else return x != v;
+}
+
+#if defined(__AVX__)
+template <TelemetryPredicate::Op Op>
+std::uint64_t compare_64(const double* x, double v) {
+    constexpr int predicate =
+        Op == TelemetryPredicate::Less ? _CMP_LT_OQ :
+        Op == TelemetryPredicate::LessEqual ? _CMP_LE_OQ :
+        Op == TelemetryPredicate::Greater ? _CMP_GT_OQ :
+        Op == TelemetryPredicate::GreaterEqual ? _CMP_GE_OQ :
+        Op == TelemetryPredicate::Equal ? _CMP_EQ_OQ : _CMP_NEQ_UQ;
+    __m256d value = _mm256_set1_pd(v);
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 64; i += 4) {
+        __m256d mask = _mm256_cmp_pd(_mm256_loadu_pd(x + i), value, predicate);
+        bits |= static_cast<std::uint64_t>(_mm256_movemask_pd(mask)) << i;
+    }
+    return bits;
+}
+#elif defined(__SSE2__) || defined(_M_X64)
+template <TelemetryPredicate::Op Op>
+__m128d compare_pd(__m128d a, __m128d b) {
+    if constexpr (Op == TelemetryPredicate::Less) return _mm_cmplt_pd(a, b);
+    else if constexpr (Op == TelemetryPredicate::LessEqual) return _mm_cmple_pd(a, b);
+    else if constexpr (Op == TelemetryPredicate::Greater) return _mm_cmpgt_pd(a, b);
+    else if constexpr (Op == TelemetryPredicate::GreaterEqual) return _mm_cmpge_pd(a, b);
+    else if constexpr (Op == TelemetryPredicate::Equal) return _mm_cmpeq_pd(a, b);
+    else return _mm_cmpneq_pd(a, b);
+}
+
+template <TelemetryPredicate::Op Op>
+std::uint64_t compare_64(const double* x, double v) {
+    __m128d value = _mm_set1_pd(v);
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 64; i += 2) {
+        __m128d mask = compare_pd<Op>(_mm_loadu_pd(x + i), value);
+        bits |= static_cast<std::uint64_t>(_mm_movemask_pd(mask)) << i;
+    }
+    return bits;
+}
+#else
+template <TelemetryPredicate::Op Op>
+std::uint64_t compare_64(const double* x, double v) {
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 64; ++i) {
+        bits |= static_cast<std::uint64_t>(compare<Op>(x[i], v)) << i;
+    }
+    return bits;
+}
+#endif
+
+// ANDs (or, for the first predicate, stores) one bit per row into `bits`
+template <TelemetryPredicate::Op Op>
+void scan_column(const double* x, std::size_t rows, double v, std::uint64_t* bits, bool first) {
+    std::size_t full_words = rows / 64;
+    for (std::size_t w = 0; w < full_words; ++w) {
+        std::uint64_t word = compare_64<Op>(x + w * 64, v);
+        bits[w] = first ? word : (bits[w] & word);
+    }
+    if (rows % 64) {
+        std::uint64_t word = 0;
+        for (std::size_t i = full_words * 64; i < rows; ++i) {
+            word |= static_cast<std::uint64_t>(compare<Op>(x[i], v)) << (i % 64);
+        }
+        bits[full_words] = first ? word : (bits[full_words] & word);
+    }
+}
+
+void scan_column(const TelemetryPredicate& p, const double* x, std::size_t rows, std::uint64_t* bits, bool first) {
+    switch (p.op) {
+    case TelemetryPredicate::Less: scan_column<TelemetryPredicate::Less>(x, rows, p.value, bits, first); break;
+    case TelemetryPredicate::LessEqual: scan_column<TelemetryPredicate::LessEqual>(x, rows, p.value, bits, first); break;
+    case TelemetryPredicate::Greater: scan_column<TelemetryPredicate::Greater>(x, rows, p.value, bits, first); break;
+    case TelemetryPredicate::GreaterEqual: scan_column<TelemetryPredicate::GreaterEqual>(x, rows, p.value, bits, first); break;
+    case TelemetryPredicate::Equal: scan_column<TelemetryPredicate::Equal>(x, rows, p.value, bits, first); break;
+    case TelemetryPredicate::NotEqual: scan_column<TelemetryPredicate::NotEqual>(x, rows, p.value, bits, first); break;
+    }
+}
+
+} // namespace
+
+ColumnarTelemetryWriter::ColumnarTelemetryWriter(const std::string& path, std::uint32_t chunk_rows) :
+    out(path, std::ios::binary | std::ios::trunc),
+    chunk_rows(std::max<std::uint32_t>(1, chunk_rows)),
+    buffered_rows(0)
+{
+    for (auto& column : columns) {
+        column.reserve(this->chunk_rows);
+    }
+    FileHeader header{};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.channel_count = TelemetryChannelCount;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+ColumnarTelemetryWriter::~ColumnarTelemetryWriter() {
+    flush();
+}
+
+bool ColumnarTelemetryWriter::is_open() const {
+    return out.good();
+}
+
+void ColumnarTelemetryWriter::append(const TelemetryFrame& frame) {
+    for (int c = 0; c < TelemetryChannelCount; ++c) {
+        columns[c].push_back(telemetry_channel_value(frame, c));
+    }
+    if (++buffered_rows == chunk_rows) {
+        write_chunk();
+    }
+}
+
+bool ColumnarTelemetryWriter::flush() {
+    if (buffered_rows > 0) {
+        write_chunk();
+    }
+    out.flush();
+    return out.good();
+}
+
+void ColumnarTelemetryWriter::write_chunk() {
+    ChunkHeader header{};
+    header.magic = CHUNK_MAGIC;
+    header.rows = buffered_rows;
+    for (int c = 0; c < TelemetryChannelCount; ++c) {
+        auto [lo, hi] = std::minmax_element(columns[c].begin(), columns[c].end());
+        header.min[c] = *lo;
+        header.max[c] = *hi;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (auto& column : columns) {
+        out.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(double));
+        column.clear();
+    }
+    buffered_rows = 0;
+}
+
+bool TelemetryQuery::parse(const std::string& text, TelemetryQuery& query, std::string& error) {
+    static const struct { const char* token; TelemetryPredicate::Op op; } OPS[] = {
+        { "<", TelemetryPredicate::Less }, { "<=", TelemetryPredicate::LessEqual },
+        { ">", TelemetryPredicate::Greater }, { ">=", TelemetryPredicate::GreaterEqual },
+        { "==", TelemetryPredicate::Equal }, { "=", TelemetryPredicate::Equal },
+        { "!=", TelemetryPredicate::NotEqual },
+    };
+
+    std::istringstream in(text);
+    std::string name, op, value;
+    query.predicates.clear();
+    while (in >> name) {
+        if (!query.predicates.empty()) {
+            if (name != "and" && name != "&&") {
+                error = "expected 'and' before '" + name + "'";
+                return false;
+            }
+            if (!(in >> name)) {
+                error = "dangling 'and'";
+                return false;
+            }
+        }
+        if (!(in >> op >> value)) {
+            error = "expected '<channel> <op> <value>' after '" + name + "'";
+            return false;
+        }
+
+        TelemetryPredicate p{};
+        p.channel = find_telemetry_channel(name.c_str());
+        if (p.channel < 0) {
+            error = "unknown channel '" + name + "'";
+            return false;
+        }
+        bool known_op = false;
+        for (const auto& entry : OPS) {
+            if (op == entry.token) {
+                p.op = entry.op;
+                known_op = true;
+            }
+        }
+        if (!known_op) {
+            error = "unknown operator '" + op + "'";
+            return false;
+        }
+        char* end = nullptr;
+        p.value = std::strtod(value.c_str(), &end);
+        if (end == value.c_str() || *end != '\0') {
+            error = "bad number '" + value + "'";
+            return false;
+        }
+        query.predicates.push_back(p);
+    }
+    return true;
+}
+
+bool run_telemetry_query(const std::string& path, const TelemetryQuery& query, TelemetryQueryResult& result, std::string& error) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    const std::streamoff file_size = in.tellg();
+    in.seekg(0);
+    FileHeader file_header{};
+    if (!in.read(reinterpret_cast<char*>(&file_header), sizeof(file_header)) ||
+        std::memcmp(file_header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 ||
+        file_header.version != FILE_VERSION || file_header.channel_count != TelemetryChannelCount) {
+        error = path + " is not a columnar telemetry file";
+        return false;
+    }
+
+    result = TelemetryQueryResult{};
+    std::vector<double> column;
+    std::vector<double> times;
+    std::vector<std::uint64_t> bits;
+    std::uint64_t row_base = 0;
+    std::uint64_t last_match_row = 0;
+
+    // Every column read is checked against the file size up front, so a
+    // truncated file is reported rather than scanned as stale data
+    ChunkHeader header;
+    while (in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        if (header.magic != CHUNK_MAGIC) {
+            error = "corrupt chunk header in " + path;
+            return false;
+        }
+        const std::streamoff data_start = in.tellg();
+        const std::streamoff column_bytes = static_cast<std::streamoff>(header.rows) * sizeof(double);
+        if (column_bytes * TelemetryChannelCount > file_size - data_start) {
+            error = path + " is truncated";
+            return false;
+        }
+        ++result.chunks;
+
+        bool may_match = true;
+        for (const auto& p : query.predicates) {
+            may_match = may_match && range_may_match(p, header.min[p.channel], header.max[p.channel]);
+        }
+
+        if (may_match) {
+            std::size_t words = (header.rows + 63) / 64;
+            bits.assign(words, ~0ull);
+            if (header.rows % 64) {
+                bits[words - 1] = (1ull << (header.rows % 64)) - 1;
+            }
+            column.resize(header.rows);
+            for (std::size_t i = 0; i < query.predicates.size(); ++i) {
+                const TelemetryPredicate& p = query.predicates[i];
+                if (!in.seekg(data_start + p.channel * column_bytes) ||
+                    !in.read(reinterpret_cast<char*>(column.data()), column_bytes)) {
+                    error = "cannot read " + path;
+                    return false;
+                }
+                scan_column(p, column.data(), header.rows, bits.data(), i == 0);
+            }
+
+            std::uint64_t matched = 0;
+            for (std::uint64_t word : bits) {
+                matched += std::popcount(word);
+            }
+            if (matched > 0) {
+                times.resize(header.rows);
+                if (!in.seekg(data_start + ChannelTime * column_bytes) ||
+                    !in.read(reinterpret_cast<char*>(times.data()), column_bytes)) {
+                    error = "cannot read " + path;
+                    return false;
+                }
+                for (std::size_t w = 0; w < words; ++w) {
+                    for (std::uint64_t word = bits[w]; word; word &= word - 1) {
+                        std::uint64_t row = w * 64 + std::countr_zero(word);
+                        std::uint64_t global_row = row_base + row;
+                        if (result.rows_matched == 0) {
+                            result.first_match_time = times[row];
+                        }
+                        if (result.rows_matched == 0 || global_row != last_match_row + 1) {
+                            ++result.match_intervals;
+                        }
+                        last_match_row = global_row;
+                        result.last_match_time = times[row];
+                        ++result.rows_matched;
+                    }
+                }
+            }
+        }
+        else {
+            ++result.chunks_skipped;
+        }
+
+        result.rows_scanned += may_match ? header.rows : 0;
+        row_base += header.rows;
+        in.seekg(data_start + TelemetryChannelCount * column_bytes);
+    }
+    if (in.gcount() != 0) {
+        error = path + " is truncated";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef TELEMETRY_COLUMNAR_H
+#define TELEMETRY_COLUMNAR_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "telemetry.h"
+
+// Columnar telemetry file: a header followed by chunks of up to chunk_rows
+// frames. Each chunk stores per-channel min/max statistics and then every
+// channel as a contiguous array of doubles, so a query reads only the
+// columns it tests and skips chunks whose ranges cannot match.
+class ColumnarTelemetryWriter {
+public:
+    static constexpr std::uint32_t DEFAULT_CHUNK_ROWS = 65536;
+
+    explicit ColumnarTelemetryWriter(const std::string& path, std::uint32_t chunk_rows = DEFAULT_CHUNK_ROWS);
+    ~ColumnarTelemetryWriter();
+
+    bool is_open() const;
+    void append(const TelemetryFrame& frame);
+    // Writes any buffered rows; false if any write to the file failed
+    bool flush();
+
+private:
+    void write_chunk();
+
+    std::ofstream out;
+    std::uint32_t chunk_rows;
+    std::uint32_t buffered_rows;
+    std::vector<double> columns[TelemetryChannelCount];
+};
+
+struct TelemetryPredicate {
+    enum Op {
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Equal,
+        NotEqual
+    };
+
+    int channel;
+    Op op;
+    double value;
+};
+
+// Conjunction of channel comparisons, e.g. "rpm > 4000 and engine_temperature > 105"
+struct TelemetryQuery {
+    std::vector<TelemetryPredicate> predicates;
+
+    static bool parse(const std::string& text, TelemetryQuery& query, std::string& error);
+};
+
+struct TelemetryQueryResult {
+    std::uint64_t chunks = 0;
+    std::uint64_t chunks_skipped = 0;
+    std::uint64_t rows_scanned = 0;
+    std::uint64_t rows_matched = 0;
+    std::uint64_t match_intervals = 0; // runs of consecutive matching frames
+    double first_match_time = 0;
+    double last_match_time = 0;
+};
+
+bool run_telemetry_query(const std::string& path, const TelemetryQuery& query, TelemetryQueryResult& result, std::string& error);
+
+#endif // TELEMETRY_COLUMNAR_H
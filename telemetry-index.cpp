@@ -0,0 +1,108 @@
+#include "telemetry-index.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char INDEX_MAGIC[4] = { 'S', 'S', 'T', 'I' };
+const std::uint32_t INDEX_VERSION = 3;
+
+struct IndexHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t entry_size;
+    std::uint32_t spec_size;    // bytes of format_engine_spec() text after the header
+    std::uint32_t performance_cache;
+    std::uint32_t reserved;
+    OperatingPointCacheConfig cache;
+};
+
+} // namespace
+
+TelemetryIndexWriter::TelemetryIndexWriter(const std::string& path, const EngineSpec& spec, const OperatingPointCacheConfig* cache,
+                                           std::uint32_t blocks_per_entry) :
+    out(path, std::ios::binary | std::ios::trunc),
+    blocks_per_entry(std::max<std::uint32_t>(1, blocks_per_entry)),
+    block_count(0)
+{
+    IndexHeader header{};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.entry_size = sizeof(TelemetryIndexEntry);
+    const std::string text = format_engine_spec(spec);
+    header.spec_size = static_cast<std::uint32_t>(text.size());
+    if (cache) {
+        header.performance_cache = 1;
+        header.cache = *cache;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(text.data(), text.size());
+}
+
+bool TelemetryIndexWriter::is_open() const {
+    return out.good();
+}
+
+bool TelemetryIndexWriter::add_block(double time, std::uint64_t offset, const EngineSnapshot& snapshot) {
+    if (block_count++ % blocks_per_entry != 0) {
+        return false;
+    }
+    TelemetryIndexEntry entry{ time, offset, snapshot };
+    out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    return true;
+}
+
+bool TelemetryIndexWriter::flush() {
+    out.flush();
+    return out.good();
+}
+
+bool TelemetryIndex::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return false;
+    }
+    std::streamoff size = in.tellg();
+    in.seekg(0);
+
+    IndexHeader header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+        header.version != INDEX_VERSION || header.entry_size != sizeof(TelemetryIndexEntry) ||
+        header.spec_size > size - static_cast<std::streamoff>(sizeof(header))) {
+        return false;
+    }
+
+    std::string text(header.spec_size, '\0');
+    std::vector<EngineSpec> specs;
+    std::string error;
+    if (!in.read(text.data(), text.size()) || !parse_engine_specs(text.data(), text.size(), path, specs, error) ||
+        specs.size() != 1) {
+        return false;
+    }
+    engine_spec = specs.front();
+    cached = header.performance_cache != 0;
+    cache_config = header.cache;
+
+    const std::streamoff data = static_cast<std::streamoff>(sizeof(header) + header.spec_size);
+    entries.resize((size - data) / sizeof(TelemetryIndexEntry));
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(TelemetryIndexEntry)));
+}
+
+const TelemetryIndexEntry* TelemetryIndex::find(double time) const {
+    auto it = std::upper_bound(entries.begin(), entries.end(), time,
+        [](double t, const TelemetryIndexEntry& entry) { return t < entry.time; });
+    return it == entries.begin() ? nullptr : &*(it - 1);
+}
+
+std::size_t TelemetryIndex::size() const {
+    return entries.size();
+}
+
+const EngineSpec& TelemetryIndex::spec() const {
+    return engine_spec;
+}
+
+const OperatingPointCacheConfig* TelemetryIndex::performance_cache() const {
+    return cached ? &cache_config : nullptr;
+}
@@ -0,0 +1,66 @@
+#ifndef TELEMETRY_INDEX_H
+#define TELEMETRY_INDEX_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "engine-state.h"
+#include "engine-spec.h"
+#include "operating-point-cache.h"
+
+// Sparse seek index stored next to a compressed telemetry stream
+// ("<log>.idx"). The header holds the engine spec the recording was made
+// with; every few blocks an entry records the block's first timestamp, its
+// byte offset in the stream and a full engine snapshot at that frame
+// (upgrades, calibration, RNG and crank state included), so a reader can
+// binary-search to any time and resume an identical engine from there.
+// When the recording used the operating-point cache, the header keeps its
+// bounds and the recorder clears the cache at every entry, so the resumed
+// engine starts from the same cache state.
+struct TelemetryIndexEntry {
+    double time;
+    std::uint64_t offset;
+    EngineSnapshot snapshot;
+};
+
+class TelemetryIndexWriter {
+public:
+    // `cache` is the recording engine's operating-point cache settings, or null
+    TelemetryIndexWriter(const std::string& path, const EngineSpec& spec, const OperatingPointCacheConfig* cache,
+                         std::uint32_t blocks_per_entry = 1);
+
+    bool is_open() const;
+    // Called at every block start; keeps one entry per blocks_per_entry
+    // blocks and returns true when it did
+    bool add_block(double time, std::uint64_t offset, const EngineSnapshot& snapshot);
+    // False if any write to the index failed
+    bool flush();
+
+private:
+    std::ofstream out;
+    std::uint32_t blocks_per_entry;
+    std::uint64_t block_count;
+};
+
+class TelemetryIndex {
+public:
+    bool load(const std::string& path);
+
+    // Last entry at or before `time`, or null if the index starts later
+    const TelemetryIndexEntry* find(double time) const;
+    std::size_t size() const;
+    // Engine the recording was made with; build it, then restore an entry's snapshot
+    const EngineSpec& spec() const;
+    // Operating-point cache settings of the recording, or null if it ran without
+    const OperatingPointCacheConfig* performance_cache() const;
+
+private:
+    EngineSpec engine_spec;
+    bool cached = false;
+    OperatingPointCacheConfig cache_config;
+    std::vector<TelemetryIndexEntry> entries;
+};
+
+#endif // TELEMETRY_INDEX_H
@@ -0,0 +1,66 @@
+#include "telemetry.h"
+#include <cstring>
+
+namespace {
+
+const char* const CHANNEL_NAMES[TelemetryChannelCount] = {
+    "time", "rpm", "torque", "power", "engine_temperature", "gear", "nox", "bsfc",
+    "vehicle_speed", "fuel_consumption", "thermal_efficiency", "acceleration", "jerk",
+    "water_injection", "manual_transmission"
+};
+
+} // namespace
+
+const char* telemetry_channel_name(int channel) {
+    return CHANNEL_NAMES[channel];
+}
+
+int find_telemetry_channel(const char* name) {
+    for (int i = 0; i < TelemetryChannelCount; ++i) {
+        if (std::strcmp(CHANNEL_NAMES[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+double telemetry_channel_value(const TelemetryFrame& frame, int channel) {
+    switch (channel) {
+    case ChannelTime: return frame.time;
+    case ChannelRpm: return frame.rpm;
+    case ChannelTorque: return frame.torque;
+    case ChannelPower: return frame.power_output;
+    case ChannelEngineTemperature: return frame.engine_temperature;
+    case ChannelGear: return frame.gear;
+    case ChannelNox: return frame.nox_emissions;
+    case ChannelBsfc: return frame.brake_specific_fuel_consumption;
+    case ChannelVehicleSpeed: return frame.vehicle_speed;
+    case ChannelFuelConsumption: return frame.fuel_consumption;
+    case ChannelThermalEfficiency: return frame.thermal_efficiency;
+    case ChannelAcceleration: return frame.acceleration;
+    case ChannelJerk: return frame.jerk;
+    case ChannelWaterInjection: return frame.water_injection_active ? 1.0 : 0.0;
+    case ChannelManualTransmission: return frame.manual_transmission ? 1.0 : 0.0;
+    }
+    return 0.0;
+}
+
+void set_telemetry_channel_value(TelemetryFrame& frame, int channel, double value) {
+    switch (channel) {
+    case ChannelTime: frame.time = value; break;
+    case ChannelRpm: frame.rpm = value; break;
+    case ChannelTorque: frame.torque = value; break;
+    case ChannelPower: frame.power_output = value; break;
+    case ChannelEngineTemperature: frame.engine_temperature = value; break;
+    case ChannelGear: frame.gear = static_cast<std::int32_t>(value); break;
+    case ChannelNox: frame.nox_emissions = value; break;
+    case ChannelBsfc: frame.brake_specific_fuel_consumption = value; break;
+    case ChannelVehicleSpeed: frame.vehicle_speed = value; break;
+    case ChannelFuelConsumption: frame.fuel_consumption = value; break;
+    case ChannelThermalEfficiency: frame.thermal_efficiency = value; break;
+    case ChannelAcceleration: frame.acceleration = value; break;
+    case ChannelJerk: frame.jerk = value; break;
+    case ChannelWaterInjection: frame.water_injection_active = value != 0.0; break;
+    case ChannelManualTransmission: frame.manual_transmission = value != 0.0; break;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <cstdint>
+
+// One recorded simulation frame
+struct TelemetryFrame {
+    double time;
+    double rpm;
+    double torque;
+    double power_output;
+    double engine_temperature;
+    std::int32_t gear;
+    double nox_emissions;
+    double brake_specific_fuel_consumption;
+    double vehicle_speed;
+    double fuel_consumption;
+    double thermal_efficiency;
+    double acceleration;
+    double jerk;
+    bool water_injection_active;
+    bool manual_transmission;
+};
+
+// Channel order shared by the telemetry file formats
+enum TelemetryChannel {
+    ChannelTime,
+    ChannelRpm,
+    ChannelTorque,
+    ChannelPower,
+    ChannelEngineTemperature,
+    ChannelGear,
+    ChannelNox,
+    ChannelBsfc,
+    ChannelVehicleSpeed,
+    ChannelFuelConsumption,
+    ChannelThermalEfficiency,
+    ChannelAcceleration,
+    ChannelJerk,
+    ChannelWaterInjection,
+    ChannelManualTransmission,
+    TelemetryChannelCount
+};
+
+const char* telemetry_channel_name(int channel);
+int find_telemetry_channel(const char* name); // -1 when unknown
+double telemetry_channel_value(const TelemetryFrame& frame, int channel);
+void set_telemetry_channel_value(TelemetryFrame& frame, int channel, double value);
+
+#endif // TELEMETRY_H
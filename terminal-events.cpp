@@ -0,0 +1,209 @@
+#include "terminal-events.h"
+#include "run-summary.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <thread>
+
+#ifdef __linux__
+#include <csignal>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+char get_user_input();
+
+#ifdef __linux__
+
+TerminalEvents::TerminalEvents() :
+    frame_interval(1.0 / 60.0),
+    raw_mode(false),
+    epoll_fd(-1),
+    timer_fd(-1),
+    signal_fd(-1),
+    saved_terminal{},
+    saved_signal_mask{}
+{
+}
+
+TerminalEvents::~TerminalEvents() {
+    close();
+}
+
+bool TerminalEvents::open(std::string& error) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    // Signals are delivered through the signalfd only while they are blocked
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGWINCH);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, &saved_signal_mask);
+    signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    if (epoll_fd < 0 || timer_fd < 0 || signal_fd < 0) {
+        error = "cannot create event descriptors";
+        sigprocmask(SIG_SETMASK, &saved_signal_mask, nullptr);
+        close();
+        return false;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u32 = FRAME;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event);
+    event.data.u32 = RESIZE;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &event);
+    // Regular files and /dev/null cannot be polled; the session then just has no keyboard
+    event.data.u32 = INPUT;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &event);
+
+    if (tcgetattr(STDIN_FILENO, &saved_terminal) == 0) {
+        termios raw = saved_terminal;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        raw_mode = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+    }
+
+    set_frame_interval(frame_interval);
+    return true;
+}
+
+void TerminalEvents::close() {
+    if (raw_mode) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved_terminal);
+        raw_mode = false;
+    }
+    if (signal_fd >= 0) {
+        sigprocmask(SIG_SETMASK, &saved_signal_mask, nullptr);
+    }
+    for (int* fd : { &epoll_fd, &timer_fd, &signal_fd }) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void TerminalEvents::set_frame_interval(double seconds) {
+    frame_interval = seconds;
+    if (timer_fd < 0) {
+        return;
+    }
+    double whole = std::floor(seconds);
+    itimerspec spec{};
+    spec.it_interval.tv_sec = static_cast<time_t>(whole);
+    spec.it_interval.tv_nsec = static_cast<long>((seconds - whole) * 1e9);
+    spec.it_value = spec.it_interval;
+    timerfd_settime(timer_fd, 0, &spec, nullptr);
+}
+
+unsigned TerminalEvents::wait(std::string& keys) {
+    keys.clear();
+    epoll_event events[4];
+    int count;
+    do {
+        count = epoll_wait(epoll_fd, events, 4, -1);
+    } while (count < 0 && errno == EINTR);
+
+    unsigned ready = 0;
+    for (int i = 0; i < count; ++i) {
+        unsigned source = events[i].data.u32;
+        if (source == FRAME) {
+            std::uint64_t expirations;
+            (void)!read(timer_fd, &expirations, sizeof(expirations));
+        }
+        else if (source == RESIZE) {
+            // Shared by all signals; sort them out by number
+            signalfd_siginfo info;
+            source = 0;
+            while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                source |= info.ssi_signo == SIGWINCH ? RESIZE : QUIT;
+            }
+        }
+        else if (source == INPUT) {
+            char buffer[64];
+            ssize_t length = read(STDIN_FILENO, buffer, sizeof(buffer));
+            if (length > 0) {
+                keys.append(buffer, static_cast<std::size_t>(length));
+            }
+            else if (length == 0) {
+                // End of input: stop watching, or it would stay readable forever
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, STDIN_FILENO, nullptr);
+                continue;
+            }
+        }
+        ready |= source;
+    }
+    return ready;
+}
+
+int TerminalEvents::columns() {
+    winsize size{};
+    if (::ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) {
+        return size.ws_col;
+    }
+    return 120;
+}
+
+#else
+
+TerminalEvents::TerminalEvents() : frame_interval(1.0 / 60.0), next_frame(0) {
+}
+
+TerminalEvents::~TerminalEvents() {
+}
+
+bool TerminalEvents::open(std::string&) {
+    install_stop_handlers();
+    set_frame_interval(frame_interval);
+    return true;
+}
+
+void TerminalEvents::close() {
+}
+
+static double seconds_now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TerminalEvents::set_frame_interval(double seconds) {
+    frame_interval = seconds;
+    next_frame = seconds_now() + seconds;
+}
+
+// Checks the keyboard every few milliseconds until the frame is due
+unsigned TerminalEvents::wait(std::string& keys) {
+    keys.clear();
+    while (true) {
+        if (stop_requested()) {
+            return QUIT;
+        }
+        for (char c = get_user_input(); c != 0; c = get_user_input()) {
+            keys.push_back(c);
+        }
+        if (!keys.empty()) {
+            return INPUT;
+        }
+        double remaining = next_frame - seconds_now();
+        if (remaining <= 0) {
+            next_frame += frame_interval * std::ceil(-remaining / frame_interval + 1e-9);
+            return FRAME;
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(std::min(remaining, 0.01)));
+    }
+}
+
+int TerminalEvents::columns() {
+    return 120;
+}
+
+#endif
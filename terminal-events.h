@@ -0,0 +1,55 @@
+#ifndef TERMINAL_EVENTS_H
+#define TERMINAL_EVENTS_H
+
+#include <string>
+
+#ifdef __linux__
+#include <csignal>
+#include <termios.h>
+#endif
+
+// Blocks the interactive loop until a key press, the next frame tick, a
+// terminal resize or a request to quit. On Linux this is one epoll set over
+// stdin, a timerfd and a signalfd for SIGWINCH, SIGINT and SIGTERM, so an idle session sleeps in the kernel between
+// ticks. The terminal is put into unbuffered, no-echo mode once on open and
+// restored on close. Elsewhere it falls back to sleeping out the frame and
+// polling the keyboard and the stop flag.
+class TerminalEvents {
+public:
+    static constexpr unsigned FRAME = 1;
+    static constexpr unsigned INPUT = 2;
+    static constexpr unsigned RESIZE = 4;
+    static constexpr unsigned QUIT = 8;   // SIGINT or SIGTERM
+
+    TerminalEvents();
+    ~TerminalEvents();
+    TerminalEvents(const TerminalEvents&) = delete;
+    TerminalEvents& operator=(const TerminalEvents&) = delete;
+
+    bool open(std::string& error);
+    void close();
+
+    // Period of the frame tick; takes effect from now
+    void set_frame_interval(double seconds);
+    // Waits for at least one event and returns them as flags. Key presses
+    // since the last call are put in `keys`.
+    unsigned wait(std::string& keys);
+
+    // Width of the terminal in characters, 120 when it cannot be queried
+    static int columns();
+
+private:
+    double frame_interval;
+#ifdef __linux__
+    bool raw_mode;
+    int epoll_fd;
+    int timer_fd;
+    int signal_fd;
+    termios saved_terminal;
+    sigset_t saved_signal_mask;
+#else
+    double next_frame;
+#endif
+};
+
+#endif // TERMINAL_EVENTS_H
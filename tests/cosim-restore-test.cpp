@@ -0,0 +1,68 @@
+// CoSimSlave promises that saving and restoring state never touches the
+// heap. Counts allocations while states with different upgrades, trims,
+// messages and math modes are restored into an engine with the
+// operating-point cache on.
+#include "cosim-slave.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::size_t> allocations{ 0 };
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main() {
+    SixStrokeEngine stock;
+    SixStrokeEngine upgraded;
+    for (const char* upgrade : { "turbocharger", "cylinder_deactivation", "ceramic_coating" }) {
+        upgraded.apply_upgrade(upgrade);
+    }
+    upgraded.set_calibration(1.1e6, { 1.02, 0.98, 1.0, 1.01, 0.9, -1.0 });
+    upgraded.set_math_mode(MathMode::Fast);
+    upgraded.set_acceleration(30);
+    upgraded.manual_upshift();   // leaves a shift message in the snapshot
+    upgraded.update_dynamics(0.5);
+
+    SixStrokeEngine engine;
+    engine.enable_performance_cache();
+    engine.set_acceleration(20);
+    engine.update_dynamics(0.5);
+    CoSimSlave slave(engine);
+
+    EngineSnapshot states[2];
+    stock.update_dynamics(0.25);
+    states[0] = stock.snapshot();
+    states[1] = upgraded.snapshot();
+    EngineSnapshot saved;
+
+    const std::size_t before = allocations.load();
+    bool ok = true;
+    for (int i = 0; i < 100; ++i) {
+        ok = ok && slave.set_state(states[i % 2]);
+        slave.get_state(saved);
+        ok = ok && slave.do_step(slave.time(), 0.01) && slave.rollback();
+    }
+    const std::size_t counted = allocations.load() - before;
+
+    std::printf("restores %s, %zu allocations\n", ok ? "ok" : "FAILED", counted);
+    return ok && counted == 0 ? 0 : 1;
+}
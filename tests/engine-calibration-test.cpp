@@ -0,0 +1,55 @@
+// Calibration files: a saved fit loads back unchanged, and lines that are
+// not exactly "<key> = <number>" are rejected.
+#include "engine-calibration.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+const std::string PATH = (std::filesystem::temp_directory_path() / "engine-calibration-test.cal").string();
+
+bool load_text(const std::string& text, CalibrationResult& result, std::string& error) {
+    std::ofstream(PATH, std::ios::trunc) << text;
+    return load_calibration(PATH, result, error);
+}
+
+} // namespace
+
+int main() {
+    int failures = 0;
+    auto check = [&](const char* name, bool ok, const std::string& detail) {
+        std::printf("%-44s %s%s\n", name, ok ? "ok" : "FAIL", ok || detail.empty() ? "" : (": " + detail).c_str());
+        failures += !ok;
+    };
+
+    CalibrationResult saved{};
+    saved.mean_effective_pressure = 1.23456789012345e6;
+    saved.trim.power = 1.0625;
+    saved.trim.temperature_offset = -2.5;
+    CalibrationResult loaded{};
+    std::string error;
+    bool ok = save_calibration(PATH, saved, error) && load_calibration(PATH, loaded, error);
+    check("round trip", ok && loaded.mean_effective_pressure == saved.mean_effective_pressure &&
+          loaded.trim.power == saved.trim.power && loaded.trim.temperature_offset == saved.trim.temperature_offset, error);
+
+    ok = load_text("mean_effective_pressure = 1.2e6   # fitted\r\npower_trim=1.1\t\n", loaded, error);
+    check("trailing blanks and comment", ok && loaded.mean_effective_pressure == 1.2e6 && loaded.trim.power == 1.1, error);
+
+    const char* malformed[] = {
+        "mean_effective_pressure = 1.2abc\n",
+        "mean_effective_pressure = 1.2 3.4\n",
+        "mean_effective_pressure = \n",
+        "mean_effective_pressure = 1.2e6\npower_trim = 1.1,\n",
+        "mean_effective_pressure = 1.2e6\nunknown_trim = 1\n",
+    };
+    for (const char* text : malformed) {
+        std::string line = text;
+        line.erase(line.find_last_not_of('\n') + 1);
+        for (char& c : line) c = c == '\n' ? '|' : c;
+        check(line.c_str(), !load_text(text, loaded, error), "accepted");
+    }
+
+    std::filesystem::remove(PATH);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+// Compares EngineModel<float> with EngineModel<double> over a grid of
+// operating points, geometries and upgrade sets, in both math modes, and
+// checks the single-precision fast_pow against libm.
+#include "engine-model.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// float carries about 7 digits; the model chains a dozen operations
+constexpr double MODEL_TOLERANCE = 1e-6;
+constexpr double FAST_POW_TOLERANCE = 2e-7;
+
+struct Worst {
+    const char* name;
+    double error = 0;
+
+    void add(double single, double reference) {
+        error = std::max(error, std::abs(single - reference) / std::max(std::abs(reference), 1e-12));
+    }
+};
+
+template <typename Scalar>
+EngineParameters<Scalar> parameters(double compression_ratio, int cylinders) {
+    return { Scalar(0.086), Scalar(0.086), Scalar(compression_ratio), Scalar(0.143), Scalar(1.2e6), Scalar(90), cylinders };
+}
+
+template <typename Scalar>
+UpgradeEffect<Scalar> upgrades(int set) {
+    switch (set) {
+    case 1: return { Scalar(1.2), Scalar(1.0), Scalar(1.15), Scalar(1.0), Scalar(1.0), Scalar(0.0) };
+    case 2: return { Scalar(1.05), Scalar(1.08), Scalar(1.1), Scalar(0.93), Scalar(0.7), Scalar(-5.0) };
+    default: return {};
+    }
+}
+
+} // namespace
+
+int main() {
+    Worst metrics[] = { { "power_output" }, { "torque" }, { "thermal_efficiency" }, { "fuel_consumption" },
+                        { "brake_specific_fuel_consumption" }, { "nox_emissions" }, { "volumetric_efficiency" },
+                        { "engine_temperature" }, { "vehicle_speed" } };
+    const MathMode modes[] = { MathMode::Libm, MathMode::Fast };
+
+    for (MathMode mode : modes) {
+        for (double compression_ratio = 8; compression_ratio <= 14; compression_ratio += 1.5) {
+            for (int cylinders : { 3, 4, 6 }) {
+                for (int set = 0; set < 3; ++set) {
+                    for (double rpm = 800; rpm <= 7000; rpm += 100) {
+                        for (double temperature = 85; temperature <= 110; temperature += 2.5) {
+                            for (double volumetric = 0.6; volumetric <= 1.05; volumetric += 0.15) {
+                                for (bool water : { false, true }) {
+                                    auto d = EngineModel<double>::update_performance(
+                                        parameters<double>(compression_ratio, cylinders), upgrades<double>(set),
+                                        { rpm, temperature, volumetric, water }, mode);
+                                    auto f = EngineModel<float>::update_performance(
+                                        parameters<float>(compression_ratio, cylinders), upgrades<float>(set),
+                                        { float(rpm), float(temperature), float(volumetric), water }, mode);
+                                    metrics[0].add(f.power_output, d.power_output);
+                                    metrics[1].add(f.torque, d.torque);
+                                    metrics[2].add(f.thermal_efficiency, d.thermal_efficiency);
+                                    metrics[3].add(f.fuel_consumption, d.fuel_consumption);
+                                    metrics[4].add(f.brake_specific_fuel_consumption, d.brake_specific_fuel_consumption);
+                                    metrics[5].add(f.nox_emissions, d.nox_emissions);
+                                    metrics[6].add(f.volumetric_efficiency, d.volumetric_efficiency);
+                                    metrics[7].add(f.engine_temperature, d.engine_temperature);
+                                }
+                            }
+                        }
+                        metrics[8].add(EngineModel<float>::calculate_vehicle_speed(float(rpm), 0.85f, 3.7f, 0.3f),
+                                       EngineModel<double>::calculate_vehicle_speed(rpm, 0.85, 3.7, 0.3));
+                    }
+                }
+            }
+        }
+    }
+
+    int failures = 0;
+    for (const Worst& worst : metrics) {
+        bool ok = worst.error <= MODEL_TOLERANCE;
+        std::printf("%-34s max rel err %.2e%s\n", worst.name, worst.error, ok ? "" : "  FAIL");
+        failures += !ok;
+    }
+
+    const double exponents[] = { 0.4, 1.3, 1.4, 0.3 / 1.3 };
+    double fast_pow_error = 0;
+    for (double exponent : exponents) {
+        const float e = static_cast<float>(exponent);
+        for (int i = 0; i < 1 << 20; ++i) {
+            const float x = 0.01f + 200.0f * static_cast<float>(i) / (1 << 20);
+            const double reference = std::pow(static_cast<double>(x), static_cast<double>(e));
+            const double error = std::abs(fast_pow(x, e) - reference) / reference;
+            fast_pow_error = std::max(fast_pow_error, error / (1 + std::abs(e * std::log(static_cast<double>(x)))));
+        }
+    }
+    bool ok = fast_pow_error <= FAST_POW_TOLERANCE;
+    std::printf("%-34s scaled rel err %.2e%s\n", "fast_pow(float)", fast_pow_error, ok ? "" : "  FAIL");
+    failures += !ok;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+// Checks that the gear planner costs each interval of a speed trace once:
+// at constant speed the fuel grows by one interval per added trace point.
+#include "gear-planner.h"
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+constexpr double SPEED = 50 / 3.6; // m/s
+
+std::vector<SpeedTracePoint> constant_trace(std::size_t points, double dt) {
+    std::vector<SpeedTracePoint> trace;
+    for (std::size_t i = 0; i < points; ++i) {
+        trace.push_back({ i * dt, SPEED });
+    }
+    return trace;
+}
+
+} // namespace
+
+int main() {
+    SixStrokeEngine engine;
+    GearPlanner planner(engine);
+    planner.set_thread_count(1);
+
+    int failures = 0;
+    auto check = [&](const char* name, double value, double expected) {
+        bool ok = std::abs(value - expected) <= 1e-12 * std::abs(expected) && expected > 0;
+        std::printf("%-40s %.9g kg, expected %.9g kg%s\n", name, value, expected, ok ? "" : "  FAIL");
+        failures += !ok;
+    };
+
+    // Two points span exactly one interval
+    GearPlan two = planner.plan(constant_trace(2, 1.0));
+    GearPlan three = planner.plan(constant_trace(3, 1.0));
+    GearPlan long_interval = planner.plan(constant_trace(2, 2.0));
+    check("three points, two intervals", three.fuel, 2 * two.fuel);
+    check("two points, one interval of 2 s", long_interval.fuel, 2 * two.fuel);
+    check("101 points, 100 intervals", planner.plan(constant_trace(101, 1.0)).fuel, 100 * two.fuel);
+
+    return failures == 0 ? 0 : 1;
+}